@@ -0,0 +1,67 @@
+#pragma once
+
+/*
+    基准测试驱动与结果报告
+    - 单机基准（--mode bench）：对指定规模的数据逐项运行 Sum/Max/排序等操作，
+      先做若干次预热，再重复测量，报告每项的最短/中位数/p95/平均用时和吞吐量
+    - 分布式测试（--mode server）：Server 逐轮记录各阶段用时，去掉预热轮后用同样的格式报告
+    报告格式：table（人读）、csv、json（便于 CI 长期跟踪 sum/max/sort 吞吐量的回归）
+*/
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum BenchFormat
+{
+    BENCH_TABLE = 0,
+    BENCH_CSV = 1,
+    BENCH_JSON = 2
+};
+int bench_format_from_name(const char* name);  // 未知的名称返回 -1
+const char* bench_format_name(int format);
+
+// 报告的输出位置：path 为 nullptr 时写到标准输出
+struct BenchOutput
+{
+    int format;
+    const char* path;
+};
+
+// 一项操作的多次测量
+struct BenchSeries
+{
+    std::string name;
+    size_t elements;            // 每次测量处理的元素个数（计算吞吐量）
+    std::vector<double> ms;     // 每次的用时（毫秒），不含预热
+};
+
+struct BenchStats
+{
+    double min_ms;
+    double median_ms;
+    double p95_ms;              // 最近秩法：升序第 ceil(0.95 * n) 个
+    double mean_ms;
+};
+BenchStats bench_stats(const std::vector<double>& ms);
+
+// 本次运行的环境说明（模式、指令集、线程数等），按顺序写入报告的每一行（csv）或 context 对象（json）
+typedef std::vector<std::pair<std::string, std::string> > BenchContext;
+
+// 写出报告，失败返回 false
+bool bench_write_report(const BenchOutput& out, const BenchContext& context, const std::vector<BenchSeries>& series);
+
+// 单机基准的参数
+#define BENCH_DEFAULT_OPS "all"
+#define BENCH_DEFAULT_WARMUP 1
+#define BENCH_DEFAULT_REPS 5
+struct BenchOptions
+{
+    size_t size;                // 元素个数，0 表示 DATANUM（文件输入时为文件中的元素个数）
+    const char* ops;            // 逗号分隔的操作名，或 all
+    int warmup;
+    int reps;
+    BenchOutput output;
+};
+int run_bench(const BenchOptions& options);    // 返回进程退出码
@@ -1,47 +1,228 @@
 #pragma once
 
 #include <cstddef>
+#include <stdint.h>
+#include <atomic>
+
+#include "transforms.hpp"
 
 // 常量定义
 #define MAX_THREADS 64
-#define SUBDATANUM 2000000
+#ifndef SUBDATANUM
+#define SUBDATANUM 2000000 // 可通过 -DSUBDATANUM=... 缩小数据规模做本机调试
+#endif
 #define DATANUM (SUBDATANUM * MAX_THREADS)
 
-// 数据分配比例：加速版Server端处理的数据比例（0-1之间）
-/* 
-    由于本组为 ubuntu系统 + ubuntu虚拟机环境，性能差距较大
-    故将服务器端处理比例调高以适应环境
-    测试时推荐修改为 0.5 
-*/
-#define portion_server 0.85 // **可修改比例以适配设备**
+// 负载均衡：启动时标定各节点吞吐量，按比例划分数据，并根据每轮完成时间修正
+#define CALIBRATION_SAMPLE (1 << 20) // 标定使用的元素个数
+#define MIN_PARTITION 1024           // 每个节点至少分到的元素个数
+#define REBALANCE_ALPHA 0.5          // 逐轮修正的平滑系数（新观测值的权重）
+
+// 求和精度模式
+// SUM_FAST：float 向量累加器，最快，结果随线程数和数据划分变化
+// SUM_EXACT：每个 log 值按 2^-SUM_FIXED_FRAC_BITS 舍入成定点整数后用 int64 累加，
+//            整数加法满足结合律，结果与线程数、节点数、数据划分无关（逐位可复现）
+//            单项量化误差不超过 2^-21，低于 [8, 16) 内 float 的半个 ULP；不超过 2^31 项时 int64 不会溢出
+enum SumMode
+{
+    SUM_FAST = 0,
+    SUM_EXACT = 1
+};
+#define SUM_FIXED_FRAC_BITS 20
+typedef int64_t SumFixed;                    // log(x) 的定点和，单位 2^-SUM_FIXED_FRAC_BITS
+double sum_fixed_to_double(SumFixed sum);    // 转为 log(sqrt(x)) 之和，只舍入一次
+int sum_mode_from_env();                     // 环境变量 PARDIST_SUM_MODE=fast|exact，默认 fast
+const char* sum_mode_name(int mode);
 
-// 全局数据
-extern float rawFloatData[DATANUM];
+// 本节点当前分段的数据（由 input.cpp 映射或分配，只包含本节点处理的部分）
+extern float* rawFloatData;
 
 // 数据初始化函数
+// 全局数据为 1..DATANUM 的一个固定排列，节点生成下标 [start, start + local_data_size) 的部分，
+// 各节点拿到的值分散在整个值域内，不按值划分
+#define SHUFFLE_BLOCK (1 << 16)     // 洗牌的块大小（元素个数，256 KB）
 void init_rawData(int start, size_t local_data_size);
 void shuffle_rawData(size_t local_data_size);
 void data_init_and_shuffle(int start, size_t local_data_size);
+uint64_t new_shuffle_seed();
+// 生成全局下标 [global_start, global_start + n) 的一块数据（n 不超过 SHUFFLE_BLOCK）并用 (seed, block) 块内洗牌
+void generate_block(size_t global_start, size_t n, float out[], uint64_t seed, uint64_t block);
 
-// 基础版本函数
+// 基础版本函数（log(sqrt(x))，即下面模板的 LogSqrtTransform 实例）
 float sumBasic(const float data[], const int len);
 float maxBasic(const float data[], const int len);
 void sortBasic(const float data[], const int len, float* result);
 
-// 归并排序辅助函数
-void merge(const float data[], size_t* indices, size_t left, size_t mid, size_t right, size_t* temp);
-void mergeSort(const float data[], size_t* indices, size_t left, size_t right, size_t* temp);
+// 按变换模板化的基础版本（变换见 transforms.hpp），basic.cpp 中为每种变换显式实例化
+// 单调变换排序时直接比较原始数据，只在写结果时变换一次
+template <typename Transform>
+float sumBasicWith(const float data[], const int len);
+template <typename Transform>
+float maxBasicWith(const float data[], const int len);
+template <typename Transform>
+void sortBasicWith(const float data[], const int len, float* result);
+
+// 归并排序辅助函数，按变换与下标宽度模板化：基础版本的长度为 int，sortBasic 使用 uint32_t 下标，
+// 下标与辅助数组的访存量比 size_t 减半；basic.cpp 中只显式实例化了 uint32_t
+template <typename Transform, typename Index>
+void merge(const float data[], Index* indices, Index left, Index mid, Index right, Index* temp);
+template <typename Transform, typename Index>
+void mergeSort(const float data[], Index* indices, Index left, Index right, Index* temp);
 
 // 加速版本函数
 float sumSpeedUp(const float data[], const int len);
 float maxSpeedUp(const float data[], const int len);
+void sumMaxSpeedUp(const float data[], const int len, float* sum, float* max);
+void sumMaxExactSpeedUp(const float data[], const int len, SumFixed* sum, float* max);
 void sortSpeedUp(const float data[], const int len, float* result);
 
+// 排序后端：环境变量 PARDIST_SORT=radix|merge，默认 radix；两者输出完全相同
+enum SortBackend
+{
+    SORT_MERGE = 0,
+    SORT_RADIX = 1
+};
+int sort_backend();             // 首次调用时读取环境变量
+int sort_backend_from_env();
+const char* sort_backend_name(int backend);
+void sortSpeedUpWith(int backend, const float data[], const int len, float* result);
+void radixSortKeys(float keys[], size_t n, float temp[]);
+// 基数排序每趟 RADIX_BITS 位；第一趟（最低位）的直方图可以由调用者按块预先统计
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+void radixBlockHistogram(const float keys[], size_t n, uint32_t hist[]);   // hist 为 RADIX_BUCKETS 个计数
+// keys 每 block 个元素一块，block_hist[b * RADIX_BUCKETS + d] 为第 b 块的第一趟直方图
+void radixSortKeysBlocked(float keys[], size_t n, float temp[], const uint32_t block_hist[], size_t block);
+// 键-下标对（8 字节）：argsort 的输出，index 为键对应元素在原数组中的位置
+struct KeyIndex
+{
+    float key;
+    uint32_t index;
+};
+void radixSortPairs(KeyIndex pairs[], size_t n, KeyIndex temp[]);  // 按键稳定排序，下标随键移动
+// result[i].key 为第 i 小的 log(sqrt(x))，result[i].index 为它在 data 中的下标（相等的键保持原顺序）
+void argsortSpeedUp(const float data[], const int len, KeyIndex result[]);
+void run_sort_benchmark();      // 在不同数据规模下比较两种后端，并比较各变换的基础与加速版本
+// 加速版本的任意变换（transform 为 TransformId），内核按本机指令集选择
+const char* transform_name(int transform);
+int transform_from_env();       // 环境变量 PARDIST_TRANSFORM=log_sqrt|sqrt|square，默认 log_sqrt
+bool transform_monotonic(int transform);
+void sumMaxTransformed(int transform, const float data[], const int len, float* sum, float* max);
+void sortTransformed(int transform, const float data[], const int len, float* result);  // 升序的 f(data[i])
+void computeSortKeys(const float data[], const int len, float keys[]);  // keys[i] = log(sqrt(data[i]))
+void sortKeys(int backend, float keys[], size_t n, float temp[]);       // 对已变换的键排序
+
+// 外部排序：分段变换、排序后写入临时文件，再 k 路归并；峰值内存（不含输入数据）不超过预算
+#define EXTERNAL_SORT_DEFAULT_MB 1024
+struct ExternalSortStats
+{
+    size_t runs;            // 有序段个数
+    size_t peak_bytes;      // 缓冲区峰值
+    double run_ms;          // 生成有序段用时
+    double merge_ms;        // 归并用时
+};
+size_t external_sort_budget();          // 环境变量 PARDIST_SORT_MEMORY_MB，默认 EXTERNAL_SORT_DEFAULT_MB
+const char* external_sort_temp_dir();   // 环境变量 PARDIST_SORT_TMPDIR，其次 TMPDIR，默认 /tmp
+// 对 data 的键排序，结果写入 out_fd（为负时只归并不写出）；返回输出的元素个数，失败返回 0
+size_t externalSortKeys(const float data[], size_t len, size_t budget_bytes, const char* temp_dir,
+                        int out_fd, ExternalSortStats* stats);
+// 同上，对全部输入数据（input.hpp）排序：逐段加载，合成数据与 stream 模式不会把全部数据读入内存
+size_t externalSortInput(size_t budget_bytes, const char* temp_dir, int out_fd, ExternalSortStats* stats);
+void run_external_sort();               // 对全部输入数据做外部排序并校验输出
+
+// 分布式样本排序：各节点取样 → 协调节点选分割点 → 按分割点全交换 → 各节点排序自己的键区间
+#define SAMPLES_PER_NODE 240        // 每个节点上报的样本个数（一条控制消息）
+#define SAMPLE_SORT_MAX_NODES 64    // 参与样本排序的节点数上限（含 Server）
+size_t pick_samples(const float keys[], size_t n, float samples[], size_t count);
+void choose_splitters(float samples[], size_t count, const double weights[], int parts, float splitters[]);
+void partition_by_splitters(const float keys[], size_t n, const float splitters[], int parts,
+                            float out[], size_t counts[]);
+
+// 流水线执行器：逐块加载本节点的数据，同一块留在缓存中时完成 Sum/Max 与排序键计算
+// SUM_EXACT 模式下 sum 由定点和 fixed 换算
+struct LocalResult
+{
+    float sum;
+    SumFixed fixed;
+    float max;
+};
+// 排序的成段阶段（run formation）：键就地排序时（汇总归并），流水线在每块键仍在缓存中时顺带完成，
+// 排序后端只做剩下的部分——SORT_RADIX 预先统计每块第一趟的直方图，基数排序省去第一趟的统计扫描；
+// SORT_MERGE 把每块（SHUFFLE_BLOCK 个元素）排成有序段，并放在合并树要求的缓冲区中，归并排序只做合并
+struct SortRuns
+{
+    int backend;
+    float* keys;
+    float* temp;        // 排序辅助数组，与 keys 同样大小
+    size_t n;
+    uint32_t* hist;     // SORT_RADIX：每块 RADIX_BUCKETS 个计数（ARENA_HISTOGRAM）
+};
+SortRuns sort_runs_prepare(int backend, float keys[], size_t n, float temp[]);
+void sort_runs_block(const SortRuns& runs, size_t offset, size_t len);  // offset 按 SHUFFLE_BLOCK 对齐，各块可以并行处理
+void sort_runs_finish(const SortRuns& runs);                            // 全部块处理完后完成排序，结果在 keys 中
+// runs 不为空时每块计算完排序键后接着做成段（样本排序的键要先交换再排序，传 nullptr）
+bool run_local_pipeline(size_t start, size_t count, int sum_mode, float keys[], const SortRuns* runs,
+                        LocalResult* result);
+
+// 缓冲区池：每个槽保留一块预先缺页、大页对齐的缓冲区，跨轮复用；同一时刻每个槽只能有一个使用者
+// 需要更大的容量时重新映射，原有内容不保留
+enum ArenaSlot
+{
+    ARENA_KEYS = 0,     // 本节点的排序键（流水线输出；gather 模式下就地排序后发送或归并）
+    ARENA_SCRATCH_A,    // 基础版本的索引数组；样本排序分桶后的键
+    ARENA_SCRATCH_B,    // 基础版本的辅助索引数组；排序辅助数组
+    ARENA_RANGE,        // 样本排序：本节点负责的键区间
+    ARENA_RESULT,       // 基础版本的排序结果；Server 汇总归并的最终结果
+    ARENA_HISTOGRAM,    // 流水线成段时各块的基数排序第一趟直方图
+    ARENA_SLOT_COUNT
+};
+struct ArenaStats
+{
+    size_t reserved_bytes;  // 当前保留的总字节数
+    size_t peak_bytes;
+    uint64_t requests;      // arena_get 调用次数
+    uint64_t reuses;        // 直接复用已有缓冲区的次数
+    uint64_t grows;         // 新映射（首次使用或扩大）的次数
+    double fault_ms;        // 预先缺页的总用时
+};
+void* arena_get(int slot, size_t bytes);        // 不返回 nullptr：映射失败时打印原因并 abort
+float* arena_floats(int slot, size_t count);
+ArenaStats arena_stats();
+void arena_print_stats();
+void arena_release_all();
+
 // 加速版本归并排序辅助函数
-void insertionSort(const float data[], size_t* indices, size_t left, size_t right);
-void mergeParallel(const float data[], size_t* indices, size_t left, size_t mid, size_t right, size_t* temp, int depth);
-void mergeSortParallel(const float data[], size_t* indices, size_t left, size_t right, size_t* temp, int depth);
+// 直接对预先计算好的键 log(sqrt(x)) 排序，不再经过索引数组；由任务窃取调度器（scheduler.hpp）驱动
+void insertionSort(float keys[], size_t left, size_t right);
+void mergeParallel(const float a[], size_t na, const float b[], size_t nb, float dst[]);  // 按合并路径分段并行
+void mergeSortParallel(float keys[], size_t n, float temp[]);
+
+// 分布式流式归并：avail 为已到达的元素个数（由接收线程递增），为 nullptr 表示数据已全部就绪
+struct SortedStream
+{
+    const float* data;
+    size_t total;
+    const std::atomic<size_t>* avail;
+};
+// 返回归并输出的元素个数；传输层关闭、等待被取消（transport_cancel_waits）或超过 PARDIST_WAIT_TIMEOUT_MS
+// 没有新数据到达时提前返回，个数少于各流之和
+size_t mergeSortedStreams(const SortedStream streams[], int k, float* result);
+
+// 负载均衡（吞吐量单位：每秒处理的元素个数）
+struct NodeThroughput
+{
+    double sum_rate;
+    double max_rate;
+    double sort_rate;
+};
+NodeThroughput calibrate_throughput(size_t sample);
+double combined_rate(const NodeThroughput& t);
+void balance_partition(const double rates[], int n, size_t total, size_t sizes[]);
+double update_rate(double rate, size_t size, double elapsed_ms);
 
 // UDP 通信函数
-void run_server();
-void run_client();
+// workers/rounds 不大于 0 时交互输入；Server 的前 warmup 轮不计入报告，report 为 nullptr 时不写报告（见 bench.hpp）
+struct BenchOutput;
+void set_server_address(const char* ip, int port);  // ip 为 nullptr 或 port 不大于 0 时保留 network_config.h 的默认值
+void run_server(int workers, int warmup, const BenchOutput* report);
+void run_client(int rounds);
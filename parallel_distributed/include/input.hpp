@@ -0,0 +1,41 @@
+#pragma once
+
+/*
+    输入数据源
+    - 合成数据（默认）：1..DATANUM 的固定排列，写入按需缺页的匿名映射，只占用本节点分段大小的内存
+    - 文件：环境变量 PARDIST_INPUT_FILE 指定二进制 float 文件（小端 float32，无文件头），
+      各节点只访问自己分段对应的文件区间
+        PARDIST_INPUT_MODE=mmap   直接映射文件（默认）；分段不超过物理内存一半时 MAP_POPULATE 预读，
+                                  否则按顺序访问由内核预读，干净页可随时回收，数据可以大于内存
+        PARDIST_INPUT_MODE=stream 按 SHUFFLE_BLOCK 分块 pread 到匿名内存，读完即丢弃页缓存
+    rawFloatData 始终指向最近一次加载的分段
+    分段可以一次加载（load_partition），也可以先准备缓冲区再由流水线执行器逐块填充
+*/
+
+#include <cstddef>
+
+enum InputKind
+{
+    INPUT_SYNTHETIC = 0,
+    INPUT_MMAP = 1,
+    INPUT_STREAM = 2
+};
+
+int input_kind();                           // 首次调用时读取环境变量
+const char* input_kind_name(int kind);
+size_t input_total();                       // 全局元素个数：文件为 文件字节数 / 4，合成数据为 DATANUM
+
+// 加载全局下标 [start, start + count) 的数据，rawFloatData 指向它；失败返回 nullptr
+float* load_partition(size_t start, size_t count);
+
+// 分块加载：input_prepare 准备分段的缓冲区或映射（不填充数据），rawFloatData 指向它；
+// input_fill_block 填充分段内 [offset, offset + n)，offset 按 SHUFFLE_BLOCK 对齐且 n 不超过 SHUFFLE_BLOCK，
+// 不同的块可以在不同线程中同时填充
+float* input_prepare(size_t start, size_t count);
+bool input_fill_block(size_t offset, size_t n);
+
+// 合成数据的缓冲区，容量至少 count 个元素（跨轮复用，不足时重新映射）
+float* input_synthetic_buffer(size_t count);
+
+// 释放当前的映射或缓冲区
+void input_release();
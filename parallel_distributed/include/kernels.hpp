@@ -0,0 +1,42 @@
+#pragma once
+
+/*
+    加速版 Sum/Max/键变换/合并内核的运行时分发
+    同一份 src/kernels.cpp 按 scalar / SSE2 / AVX2+FMA / AVX-512 各编译一次，
+    启动时用 cpuid 选出本机支持的最快版本，整个程序只需一个二进制
+*/
+
+#include "common.hpp"
+#include "transforms.hpp"
+
+#include <cstddef>
+
+// 一种变换 f 的 Sum/Max/键变换内核（同一组模板按 transforms.hpp 中的变换各实例化一次）
+struct TransformKernels
+{
+    float (*sum)(const float data[], const int len);                        // sum f(data[i])
+    float (*max)(const float data[], const int len);                        // max f(data[i])
+    void (*sum_max)(const float data[], const int len, float* sum, float* max);
+    void (*keys)(const float data[], const int len, float keys[]);          // keys[i] = f(data[i])，可以就地变换
+};
+
+struct KernelTable
+{
+    const char* name;
+    float (*sum)(const float data[], const int len);
+    float (*max)(const float data[], const int len);
+    void (*sum_max)(const float data[], const int len, float* sum, float* max);
+    void (*sum_max_exact)(const float data[], const int len, SumFixed* sum, float* max);  // sum 为 log(x) 的定点和
+    void (*log_keys)(const float data[], const int len, float keys[]);  // keys[i] = log(sqrt(data[i]))
+    void (*merge)(const float a[], size_t na, const float b[], size_t nb, float dst[]);  // 单线程合并两段有序键（双调合并网络）
+    TransformKernels transforms[TRANSFORM_COUNT];   // 按 TransformId 索引；上面几项即 log_sqrt 的实例
+};
+
+// 各指令集版本（由 CMake 分别以不同编译选项构建）
+extern const KernelTable g_kernels_scalar;
+extern const KernelTable g_kernels_sse2;
+extern const KernelTable g_kernels_avx2;
+extern const KernelTable g_kernels_avx512;
+
+// 首次调用时检测 CPU 并选定内核；环境变量 PARDIST_ISA 可强制指定（scalar/sse2/avx2/avx512）
+const KernelTable& speedup_kernels();
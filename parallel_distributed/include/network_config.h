@@ -15,4 +15,14 @@
 #define SERVER_PORT 9999  // **两个设备可修改为同一端口，建议9999**
 #define CLIENT_PORT 8080  // 客户端连接端口(实际未使用)
 
+// 传输层配置（见 transport.hpp，可被环境变量覆盖）
+#define TRANSPORT_MTU 1500            // 链路MTU，数据包按此切分（本机回环可调大）
+#define TRANSPORT_WINDOW 1024         // 发送窗口：未确认的数据包个数上限
+#define TRANSPORT_RTO_MS 10           // 重传超时
+#define TRANSPORT_BATCH 64            // sendmmsg/recvmmsg 每次批量收发的包数
+#define TRANSPORT_CTRL_RETRIES 100    // 控制消息最大重传次数
+#define TRANSPORT_BULK_TIMEOUT_MS 10000 // 大块传输无任何进展时放弃
+#define TRANSPORT_SOCKET_BUFFER (16 * 1024 * 1024) // 套接字收发缓冲区
+#define TRANSPORT_WAIT_TIMEOUT_MS 600000 // 等待对端消息的上限（包括 Worker 等待 Server 执行基础版本），超时后结束测试
+
 #endif // NETWORK_CONFIG_H
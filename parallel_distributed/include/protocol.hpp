@@ -0,0 +1,146 @@
+#pragma once
+
+/*
+    节点间控制消息的二进制格式
+    报头固定 16 字节，负载为原始的 int32 / IEEE-754 double，
+    所有节点均为 x86 小端主机，直接按主机字节序传输
+*/
+
+#include <cstddef>
+#include <stdint.h>
+#include "common.hpp"
+
+#define PROTOCOL_MAGIC 0x5044      // "PD"
+#define PROTOCOL_VERSION 8
+#define PROTOCOL_MAX_PAYLOAD 1024
+
+// 消息类型，新增操作时在此追加并在接收端的处理表中登记
+enum MessageType
+{
+    MSG_JOIN = 1,           // Worker -> Server，负载: JoinPayload
+    MSG_ASSIGN,             // Server -> Worker，负载: AssignPayload，同时作为本轮开始信号
+    MSG_RESULT_SUM,         // 负载: SumPayload
+    MSG_RESULT_MAX,         // 负载: double
+    MSG_RESULTS_READY,      // Worker -> Server，负载: ReadyPayload，本轮结束（或失败）
+    MSG_PEERS,              // Server -> Worker，负载: PeersPayload，所有节点的地址（样本排序时节点间直接交换）
+    MSG_SAMPLES,            // Worker -> Server，负载: SamplesPayload
+    MSG_SPLITTERS,          // Server -> Worker，负载: SplittersPayload
+    MSG_EXCHANGE_OFFER,     // 节点 -> 节点，负载: ExchangePayload，告知将要发送的键个数
+    MSG_EXCHANGE_PULL,      // 节点 -> 节点，负载: ExchangePayload，接收缓冲区已登记，可以开始发送
+    MSG_RANGE_SUMMARY,      // Worker -> Server，负载: RangePayload，本节点排序完成的键区间
+    MSG_ABORT,              // Server -> Worker，无负载，本轮失败，结束测试
+    MSG_TYPE_COUNT
+};
+
+// Worker 加入时报告请求的轮数和启动标定的吞吐量（元素/秒）
+struct JoinPayload
+{
+    int32_t run_times;
+    int32_t reserved;
+    double sum_rate;
+    double max_rate;
+    double sort_rate;
+};
+
+// 分布式排序方式，由 Server 统一决定
+enum DistSortMode
+{
+    DIST_SORT_SAMPLE = 0,   // 样本排序：按分割点全交换，每个节点排序一段全局有序的键区间
+    DIST_SORT_GATHER = 1    // 汇总归并：各节点排序本地数据后流式发给 Server 多路归并
+};
+
+// 本轮分配给Worker的全局下标 [start, start + size)，汇总归并时排序结果通过 stream 流回传
+struct AssignPayload
+{
+    int32_t worker_id;
+    int32_t run_times;      // Server 实际执行的总轮数
+    uint32_t stream;
+    uint32_t sum_mode;      // SUM_FAST / SUM_EXACT，由 Server 统一决定
+    uint64_t start;
+    uint64_t size;
+    uint32_t dist_sort;     // DistSortMode
+    uint32_t reserved;
+};
+
+// 节点地址表，下标为节点编号：0 为 Server，i 为 Worker i-1（Server 一项不使用）
+struct PeerAddress
+{
+    uint32_t ip;            // 网络字节序
+    uint16_t port;          // 网络字节序
+    uint16_t reserved;
+};
+
+struct PeersPayload
+{
+    uint32_t count;
+    uint32_t reserved;
+    PeerAddress peers[SAMPLE_SORT_MAX_NODES];
+};
+
+struct SamplesPayload
+{
+    uint32_t node;
+    uint32_t count;
+    float samples[SAMPLES_PER_NODE];
+};
+
+// 节点 j 负责 [splitters[j-1], splitters[j]) 内的键
+struct SplittersPayload
+{
+    uint32_t count;         // 分割点个数 = 节点数 - 1
+    float splitters[SAMPLE_SORT_MAX_NODES - 1];
+};
+
+// 样本排序的一次点对点传输：src 把 count 个键经流 exchange_stream_id(round, src, dst) 发给 dst
+struct ExchangePayload
+{
+    uint32_t src;
+    uint32_t dst;
+    uint64_t count;
+};
+
+// 样本排序结束时节点上报自己的区间，Server 据此校验全局有序
+struct RangePayload
+{
+    uint32_t node;
+    uint32_t sorted;        // 本地是否有序
+    uint64_t count;
+    float first;
+    float last;
+};
+
+// Worker 本轮结束的报告：elapsed_ms 为计算+传输用时；compute_ms 只含本地计算（流水线与本地排序，
+// 不含等待其他节点与传输），用于逐轮修正划分；failed 非 0 表示本轮失败（例如大块发送超时），Server 随即中止测试
+struct ReadyPayload
+{
+    double elapsed_ms;
+    double compute_ms;
+    uint32_t failed;
+    uint32_t reserved;
+};
+
+// Worker 的部分和：sum 为 log(sqrt(x)) 之和；SUM_EXACT 模式下另附 log(x) 的定点和（SumFixed），
+// Server 对定点和做整数加法，最终结果与节点数、数据划分无关
+struct SumPayload
+{
+    double sum;
+    int64_t fixed;
+};
+
+struct MessageHeader
+{
+    uint16_t magic;
+    uint8_t version;
+    uint8_t type;
+    int32_t round;          // 所属轮次，握手阶段为 0
+    uint32_t seq;           // 发送端消息序号
+    uint32_t length;        // 负载字节数
+};
+
+// 编码一条消息到 buffer，返回总字节数
+size_t encode_message(char* buffer, uint8_t type, int32_t round, const void* payload, uint32_t length);
+
+// 解码并校验报头（魔数、版本、长度），成功时 payload 指向负载
+bool decode_message(const char* buffer, size_t len, MessageHeader* header, const char** payload);
+
+const char* message_type_name(uint8_t type);
@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+    任务窃取调度器（归并排序后端使用）
+    - ws_run 以当前 OpenMP 线程数开一组工作线程，每个线程一个 Chase–Lev 双端队列：
+      自己在底部压入/弹出（后进先出，缓存友好），空闲时随机挑一个线程从顶部窃取（先进先出，拿到的是较大的任务）
+    - 任务以 fork-join 方式使用：ws_spawn 压入子任务后调用者继续做自己那一份，ws_wait 等待同组的子任务，
+      等待期间不阻塞而是执行自己队列中或窃取来的任务
+    - WsTask/WsGroup 通常放在调用者的栈上：ws_wait 返回之前它们不会被释放，调度器本身不分配内存
+    - 不在 ws_run 之内（或队列已满）时 ws_spawn 直接执行任务，调用方不需要区分
+*/
+
+#include <atomic>
+#include <cstddef>
+
+#define WS_DEQUE_CAPACITY (1 << 13)     // 每个工作线程队列的任务个数，必须为 2 的幂
+
+// 一组待等待的子任务
+struct WsGroup
+{
+    std::atomic<int> pending;
+};
+
+struct WsTask
+{
+    void (*run)(void* arg);
+    void* arg;
+    WsGroup* group;
+};
+
+void ws_group_init(WsGroup* group);
+void ws_spawn(WsGroup* group, WsTask* task, void (*run)(void* arg), void* arg);
+void ws_wait(WsGroup* group);
+
+// 开启工作线程并在 0 号线程上执行 root(arg)，root 返回后所有线程退出；可以嵌套调用（嵌套时只有一个线程）
+void ws_run(void (*root)(void* arg), void* arg);
+int ws_workers();               // 当前 ws_run 的工作线程数，不在 ws_run 之内时为 1
+
+// 并行循环：body(arg, i)，i ∈ [0, count)，按二分递归拆成任务，在 ws_run 之内调用
+void ws_for(size_t count, void (*body)(void* arg, size_t i), void* arg);
@@ -0,0 +1,418 @@
+#pragma once
+
+/*
+    向量化自然对数 log(x)，SSE2(4路) / AVX2+FMA(8路) / AVX-512(16路) 三种实现
+    算法（同 Cephes logf）：x = m * 2^e，m 规约到 [sqrt(0.5), sqrt(2))，
+    log(m) 用 9 阶多项式逼近，log(2) 拆成高低两部分与 e 相乘以减小舍入误差
+
+    误差：在 [1, 2^28) 的全部 float 上与双精度 log 比较，四种实现的最大误差均为 0.83 ULP（< 1 ULP）
+    定义域：正的规格化数；非正数与非规格化数被钳到 FLT_MIN，不处理 inf/NaN
+
+    log(sqrt(x)) = 0.5 * log(x)，乘 0.5 是精确运算，因此 sqrt 可以省去
+*/
+
+#include "common.hpp"
+
+#include <immintrin.h>
+#include <stdint.h>
+#include <cstring>
+
+// 多项式系数
+#define LOG_SQRTHF 0.707106781186547524f
+#define LOG_P0 7.0376836292E-2f
+#define LOG_P1 -1.1514610310E-1f
+#define LOG_P2 1.1676998740E-1f
+#define LOG_P3 -1.2420140846E-1f
+#define LOG_P4 1.4249322787E-1f
+#define LOG_P5 -1.6668057665E-1f
+#define LOG_P6 2.0000714765E-1f
+#define LOG_P7 -2.4999993993E-1f
+#define LOG_P8 3.3333331174E-1f
+#define LOG_Q1 -2.12194440e-4f
+#define LOG_Q2 0.693359375f
+#define LOG_MIN_NORM 1.17549435e-38f
+
+// 标量版本（用于尾部元素），误差界与向量版本相同
+static inline float log_scalar(float x)
+{
+    if (!(x >= LOG_MIN_NORM))
+        x = LOG_MIN_NORM;
+
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    float e = (float)((int)(bits >> 23) - 0x7f + 1);
+    bits = (bits & 0x807FFFFFu) | 0x3F000000u;  // 尾数规约到 [0.5, 1)
+    float m;
+    memcpy(&m, &bits, sizeof(m));
+
+    if (m < LOG_SQRTHF)
+    {
+        e -= 1.0f;
+        m = m + m - 1.0f;
+    }
+    else
+    {
+        m = m - 1.0f;
+    }
+
+    float z = m * m;
+    float y = LOG_P0;
+    y = y * m + LOG_P1;
+    y = y * m + LOG_P2;
+    y = y * m + LOG_P3;
+    y = y * m + LOG_P4;
+    y = y * m + LOG_P5;
+    y = y * m + LOG_P6;
+    y = y * m + LOG_P7;
+    y = y * m + LOG_P8;
+    y = y * m * z;
+    y += LOG_Q1 * e;
+    y -= 0.5f * z;
+    return m + y + LOG_Q2 * e;
+}
+
+#if defined(__SSE2__)
+static inline __m128 log_ps_sse(__m128 x)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    x = _mm_max_ps(x, _mm_set1_ps(LOG_MIN_NORM));
+
+    __m128i xi = _mm_castps_si128(x);
+    __m128i ei = _mm_sub_epi32(_mm_srli_epi32(xi, 23), _mm_set1_epi32(0x7f - 1));
+    xi = _mm_or_si128(_mm_and_si128(xi, _mm_set1_epi32(0x807FFFFF)), _mm_set1_epi32(0x3F000000));
+    __m128 m = _mm_castsi128_ps(xi);
+    __m128 e = _mm_cvtepi32_ps(ei);
+
+    __m128 mask = _mm_cmplt_ps(m, _mm_set1_ps(LOG_SQRTHF));
+    __m128 tmp = _mm_and_ps(m, mask);
+    m = _mm_sub_ps(m, one);
+    e = _mm_sub_ps(e, _mm_and_ps(one, mask));
+    m = _mm_add_ps(m, tmp);
+
+    __m128 z = _mm_mul_ps(m, m);
+    __m128 y = _mm_set1_ps(LOG_P0);
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(LOG_P1));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(LOG_P2));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(LOG_P3));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(LOG_P4));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(LOG_P5));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(LOG_P6));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(LOG_P7));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(LOG_P8));
+    y = _mm_mul_ps(_mm_mul_ps(y, m), z);
+    y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(LOG_Q1)));
+    y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+    return _mm_add_ps(_mm_add_ps(m, y), _mm_mul_ps(e, _mm_set1_ps(LOG_Q2)));
+}
+#endif
+
+#if defined(__AVX2__) && defined(__FMA__)
+static inline __m256 log_ps_avx2(__m256 x)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    x = _mm256_max_ps(x, _mm256_set1_ps(LOG_MIN_NORM));
+
+    __m256i xi = _mm256_castps_si256(x);
+    __m256i ei = _mm256_sub_epi32(_mm256_srli_epi32(xi, 23), _mm256_set1_epi32(0x7f - 1));
+    xi = _mm256_or_si256(_mm256_and_si256(xi, _mm256_set1_epi32(0x807FFFFF)), _mm256_set1_epi32(0x3F000000));
+    __m256 m = _mm256_castsi256_ps(xi);
+    __m256 e = _mm256_cvtepi32_ps(ei);
+
+    __m256 mask = _mm256_cmp_ps(m, _mm256_set1_ps(LOG_SQRTHF), _CMP_LT_OQ);
+    __m256 tmp = _mm256_and_ps(m, mask);
+    m = _mm256_sub_ps(m, one);
+    e = _mm256_sub_ps(e, _mm256_and_ps(one, mask));
+    m = _mm256_add_ps(m, tmp);
+
+    __m256 z = _mm256_mul_ps(m, m);
+    __m256 y = _mm256_set1_ps(LOG_P0);
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(LOG_P1));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(LOG_P2));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(LOG_P3));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(LOG_P4));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(LOG_P5));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(LOG_P6));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(LOG_P7));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(LOG_P8));
+    y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+    y = _mm256_fmadd_ps(e, _mm256_set1_ps(LOG_Q1), y);
+    y = _mm256_fnmadd_ps(z, _mm256_set1_ps(0.5f), y);
+    return _mm256_fmadd_ps(e, _mm256_set1_ps(LOG_Q2), _mm256_add_ps(m, y));
+}
+#endif
+
+#if defined(__AVX512F__)
+static inline __m512 log_ps_avx512(__m512 x)
+{
+    const __m512 one = _mm512_set1_ps(1.0f);
+    x = _mm512_max_ps(x, _mm512_set1_ps(LOG_MIN_NORM));
+
+    __m512i xi = _mm512_castps_si512(x);
+    __m512i ei = _mm512_sub_epi32(_mm512_srli_epi32(xi, 23), _mm512_set1_epi32(0x7f - 1));
+    xi = _mm512_or_si512(_mm512_and_si512(xi, _mm512_set1_epi32(0x807FFFFF)), _mm512_set1_epi32(0x3F000000));
+    __m512 m = _mm512_castsi512_ps(xi);
+    __m512 e = _mm512_cvtepi32_ps(ei);
+
+    __mmask16 mask = _mm512_cmp_ps_mask(m, _mm512_set1_ps(LOG_SQRTHF), _CMP_LT_OQ);
+    m = _mm512_mask_add_ps(_mm512_sub_ps(m, one), mask, _mm512_sub_ps(m, one), m);
+    e = _mm512_mask_sub_ps(e, mask, e, one);
+
+    __m512 z = _mm512_mul_ps(m, m);
+    __m512 y = _mm512_set1_ps(LOG_P0);
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(LOG_P1));
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(LOG_P2));
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(LOG_P3));
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(LOG_P4));
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(LOG_P5));
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(LOG_P6));
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(LOG_P7));
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(LOG_P8));
+    y = _mm512_mul_ps(_mm512_mul_ps(y, m), z);
+    y = _mm512_fmadd_ps(e, _mm512_set1_ps(LOG_Q1), y);
+    y = _mm512_fnmadd_ps(z, _mm512_set1_ps(0.5f), y);
+    return _mm512_fmadd_ps(e, _mm512_set1_ps(LOG_Q2), _mm512_add_ps(m, y));
+}
+#endif
+
+/*
+    当前编译目标下最宽的向量类型，加速版的 Sum/Max/Sort 内核只依赖下面这组操作
+    vsqrt 为 IEEE 正确舍入的平方根（标量版本用编译器内建函数，不引入 <cmath> 的 inline 函数）
+    定义 PARDIST_SCALAR_KERNELS 时退化为单个 float（不使用任何 SIMD 指令的参考版本）
+*/
+#if defined(PARDIST_SCALAR_KERNELS)
+typedef float vfloat;
+#define VLANES 1
+#define VISA_NAME "scalar"
+static inline vfloat vload(const float* p) { return *p; }
+static inline void vstore(float* p, vfloat v) { *p = v; }
+static inline vfloat vset1(float x) { return x; }
+static inline vfloat vadd(vfloat a, vfloat b) { return a + b; }
+static inline vfloat vmul(vfloat a, vfloat b) { return a * b; }
+static inline vfloat vmax(vfloat a, vfloat b) { return (a > b) ? a : b; }
+static inline vfloat vlog(vfloat x) { return log_scalar(x); }
+static inline vfloat vsqrt(vfloat x) { return __builtin_sqrtf(x); }
+static inline float vreduce_add(vfloat v) { return v; }
+static inline float vreduce_max(vfloat v) { return v; }
+#elif defined(__AVX512F__)
+typedef __m512 vfloat;
+#define VLANES 16
+#define VISA_NAME "avx512"
+static inline vfloat vload(const float* p) { return _mm512_loadu_ps(p); }
+static inline void vstore(float* p, vfloat v) { _mm512_storeu_ps(p, v); }
+static inline vfloat vset1(float x) { return _mm512_set1_ps(x); }
+static inline vfloat vadd(vfloat a, vfloat b) { return _mm512_add_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return _mm512_mul_ps(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return _mm512_max_ps(a, b); }
+static inline vfloat vlog(vfloat x) { return log_ps_avx512(x); }
+static inline vfloat vsqrt(vfloat x) { return _mm512_sqrt_ps(x); }
+static inline float vreduce_add(vfloat v) { return _mm512_reduce_add_ps(v); }
+static inline float vreduce_max(vfloat v) { return _mm512_reduce_max_ps(v); }
+#elif defined(__AVX2__) && defined(__FMA__)
+typedef __m256 vfloat;
+#define VLANES 8
+#define VISA_NAME "avx2"
+static inline vfloat vload(const float* p) { return _mm256_loadu_ps(p); }
+static inline void vstore(float* p, vfloat v) { _mm256_storeu_ps(p, v); }
+static inline vfloat vset1(float x) { return _mm256_set1_ps(x); }
+static inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+static inline vfloat vlog(vfloat x) { return log_ps_avx2(x); }
+static inline vfloat vsqrt(vfloat x) { return _mm256_sqrt_ps(x); }
+static inline float vreduce_add(vfloat v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+static inline float vreduce_max(vfloat v)
+{
+    __m128 s = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_max_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+#else
+typedef __m128 vfloat;
+#define VLANES 4
+#define VISA_NAME "sse2"
+static inline vfloat vload(const float* p) { return _mm_loadu_ps(p); }
+static inline void vstore(float* p, vfloat v) { _mm_storeu_ps(p, v); }
+static inline vfloat vset1(float x) { return _mm_set1_ps(x); }
+static inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+static inline vfloat vlog(vfloat x) { return log_ps_sse(x); }
+static inline vfloat vsqrt(vfloat x) { return _mm_sqrt_ps(x); }
+static inline float vreduce_add(vfloat v)
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+static inline float vreduce_max(vfloat v)
+{
+    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+#endif
+
+/*
+    定点累加（SUM_EXACT 模式）：v * 2^SUM_FIXED_FRAC_BITS 在 float 中是精确的，
+    再按就近舍入转成 int32（与 MXCSR 默认舍入方式一致，标量与向量结果相同）
+    log 值的绝对值不超过 88.8，单个定点值小于 2^26.5，int32 通道可以连续累加 VFIXED_BATCH 次，
+    之后符号扩展加到 int64 通道累加器 vfixed 上
+*/
+#define VFIXED_SCALE ((float)(1 << SUM_FIXED_FRAC_BITS))
+#define VFIXED_BATCH 16
+
+static inline int32_t fixed_round_scalar(float v)
+{
+    return _mm_cvtss_si32(_mm_set_ss(v * VFIXED_SCALE));
+}
+
+#if defined(PARDIST_SCALAR_KERNELS)
+typedef int32_t vint;
+typedef int64_t vfixed;
+static inline vint vint_zero() { return 0; }
+static inline vint vfixed_round(vint acc, vfloat v) { return acc + fixed_round_scalar(v); }
+static inline vfixed vfixed_zero() { return 0; }
+static inline vfixed vfixed_widen_add(vfixed acc, vint x) { return acc + x; }
+static inline int64_t vfixed_reduce(vfixed acc) { return acc; }
+#elif defined(__AVX512F__)
+typedef __m512i vint;
+typedef __m512i vfixed;
+static inline vint vint_zero() { return _mm512_setzero_si512(); }
+static inline vint vfixed_round(vint acc, vfloat v)
+{
+    return _mm512_add_epi32(acc, _mm512_cvtps_epi32(_mm512_mul_ps(v, _mm512_set1_ps(VFIXED_SCALE))));
+}
+static inline vfixed vfixed_zero() { return _mm512_setzero_si512(); }
+static inline vfixed vfixed_widen_add(vfixed acc, vint x)
+{
+    acc = _mm512_add_epi64(acc, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(x)));
+    return _mm512_add_epi64(acc, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(x, 1)));
+}
+static inline int64_t vfixed_reduce(vfixed acc) { return _mm512_reduce_add_epi64(acc); }
+#elif defined(__AVX2__) && defined(__FMA__)
+typedef __m256i vint;
+typedef __m256i vfixed;
+static inline vint vint_zero() { return _mm256_setzero_si256(); }
+static inline vint vfixed_round(vint acc, vfloat v)
+{
+    return _mm256_add_epi32(acc, _mm256_cvtps_epi32(_mm256_mul_ps(v, _mm256_set1_ps(VFIXED_SCALE))));
+}
+static inline vfixed vfixed_zero() { return _mm256_setzero_si256(); }
+static inline vfixed vfixed_widen_add(vfixed acc, vint x)
+{
+    acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)));
+    return _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+}
+static inline int64_t vfixed_reduce(vfixed acc)
+{
+    __m128i t = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    return _mm_cvtsi128_si64(_mm_add_epi64(t, _mm_unpackhi_epi64(t, t)));
+}
+#else
+typedef __m128i vint;
+typedef __m128i vfixed;
+static inline vint vint_zero() { return _mm_setzero_si128(); }
+static inline vint vfixed_round(vint acc, vfloat v)
+{
+    return _mm_add_epi32(acc, _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(VFIXED_SCALE))));
+}
+static inline vfixed vfixed_zero() { return _mm_setzero_si128(); }
+static inline vfixed vfixed_widen_add(vfixed acc, vint x)
+{
+    // SSE2 没有 32->64 位符号扩展指令，用符号位掩码与原值交错
+    __m128i sign = _mm_srai_epi32(x, 31);
+    acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(x, sign));
+    return _mm_add_epi64(acc, _mm_unpackhi_epi32(x, sign));
+}
+static inline int64_t vfixed_reduce(vfixed acc)
+{
+    return _mm_cvtsi128_si64(_mm_add_epi64(acc, _mm_unpackhi_epi64(acc, acc)));
+}
+#endif
+
+/*
+    双调合并网络：lo、hi 各自升序，合并后 lo 为 2 * VLANES 个元素中最小的 VLANES 个、hi 为其余的，两者仍升序
+    先把 hi 反转与 lo 逐通道比较（得到两个双调序列，lo 中的都不大于 hi 中的），再对每个向量做 log2(VLANES) 级半清洗
+    每对比较的两个位置：较小位置取 min(x, y)、较大位置取 max(y, x)——min/max 在相等（含 +0/-0）或有 NaN 时都返回第二个操作数，
+    这样每对元素总是整体交换或不交换，输出恰好是输入位模式的一个排列（不会把 -0 变成 +0，也不会复制 NaN）
+*/
+#if defined(PARDIST_SCALAR_KERNELS)
+static inline void vbitonic_merge(vfloat* lo, vfloat* hi)
+{
+    if (*hi < *lo)
+    {
+        const vfloat t = *lo;
+        *lo = *hi;
+        *hi = t;
+    }
+}
+#elif defined(__AVX512F__)
+// 通道 i 与 i ^ d 比较，(i & d) != 0 的通道取较大值
+static inline __m512 bitonic_stage_avx512(__m512 v, __m512i swap, __mmask16 upper)
+{
+    const __m512 p = _mm512_permutexvar_ps(swap, v);
+    return _mm512_mask_blend_ps(upper, _mm512_min_ps(v, p), _mm512_max_ps(v, p));
+}
+
+static inline __m512 bitonic_clean_avx512(__m512 v)
+{
+    v = bitonic_stage_avx512(v, _mm512_set_epi32(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8), 0xFF00);
+    v = bitonic_stage_avx512(v, _mm512_set_epi32(11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4), 0xF0F0);
+    v = bitonic_stage_avx512(v, _mm512_set_epi32(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2), 0xCCCC);
+    return bitonic_stage_avx512(v, _mm512_set_epi32(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1), 0xAAAA);
+}
+
+static inline void vbitonic_merge(vfloat* lo, vfloat* hi)
+{
+    const __m512 r = _mm512_permutexvar_ps(_mm512_set_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), *hi);
+    const __m512 l = _mm512_min_ps(*lo, r);
+    const __m512 h = _mm512_max_ps(r, *lo);
+    *lo = bitonic_clean_avx512(l);
+    *hi = bitonic_clean_avx512(h);
+}
+#elif defined(__AVX2__) && defined(__FMA__)
+static inline __m256 bitonic_clean_avx2(__m256 v)
+{
+    __m256 p = _mm256_permute2f128_ps(v, v, 1);
+    v = _mm256_blend_ps(_mm256_min_ps(v, p), _mm256_max_ps(v, p), 0xF0);
+    p = _mm256_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm256_blend_ps(_mm256_min_ps(v, p), _mm256_max_ps(v, p), 0xCC);
+    p = _mm256_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_blend_ps(_mm256_min_ps(v, p), _mm256_max_ps(v, p), 0xAA);
+}
+
+static inline void vbitonic_merge(vfloat* lo, vfloat* hi)
+{
+    const __m256 r = _mm256_permutevar8x32_ps(*hi, _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m256 l = _mm256_min_ps(*lo, r);
+    const __m256 h = _mm256_max_ps(r, *lo);
+    *lo = bitonic_clean_avx2(l);
+    *hi = bitonic_clean_avx2(h);
+}
+#else
+// SSE2 没有 blendps，用 shufps 取出 min/max 中需要的通道
+static inline __m128 bitonic_clean_sse(__m128 v)
+{
+    __m128 p = _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm_shuffle_ps(_mm_min_ps(v, p), _mm_max_ps(v, p), _MM_SHUFFLE(3, 2, 1, 0));    // [min0, min1, max2, max3]
+    p = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    const __m128 t = _mm_shuffle_ps(_mm_min_ps(v, p), _mm_max_ps(v, p), _MM_SHUFFLE(3, 1, 2, 0));  // [min0, min2, max1, max3]
+    return _mm_shuffle_ps(t, t, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+static inline void vbitonic_merge(vfloat* lo, vfloat* hi)
+{
+    const __m128 r = _mm_shuffle_ps(*hi, *hi, _MM_SHUFFLE(0, 1, 2, 3));
+    const __m128 l = _mm_min_ps(*lo, r);
+    const __m128 h = _mm_max_ps(r, *lo);
+    *lo = bitonic_clean_sse(l);
+    *hi = bitonic_clean_sse(h);
+}
+#endif
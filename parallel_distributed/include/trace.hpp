@@ -0,0 +1,49 @@
+#pragma once
+
+/*
+    热路径的阶段追踪
+    环境变量 PARDIST_TRACE=<前缀>（或命令行 --trace）开启，未开启时每个追踪点只多一次分支
+    - 时间戳用 rdtsc 读取，启动时对照 CLOCK_REALTIME 标定频率，换算成墙上时间（微秒），
+      各节点时钟同步（NTP）时不同机器的追踪可以放在同一条时间轴上对比
+    - 每个线程一个环形缓冲区（TRACE_RING_EVENTS 个事件），写满后覆盖最早的事件，记录时不加锁
+    - 进程结束前 trace_write 写出 <前缀>.<角色>.<pid>.json（Chrome trace 格式，
+      chrome://tracing 或 ui.perfetto.dev 可直接打开；多个节点的文件把 traceEvents 数组拼接即可合并）
+    本文件不能被 kernels.cpp 包含（rdtsc 的 inline 函数，见 kernels.cpp 开头的说明）
+*/
+
+#include <stdint.h>
+#include <x86intrin.h>
+
+#define TRACE_RING_EVENTS (1 << 16)     // 每线程的事件个数（每个事件 32 字节）
+
+extern bool g_traceEnabled;
+
+void trace_init();                      // 读取环境变量并标定 TSC 频率，main 开始时调用一次
+void trace_record(const char* name, uint64_t begin, uint64_t end, uint64_t arg);  // name 须为静态字符串
+void trace_set_thread_name(const char* name);   // 在 Chrome trace 中显示的线程名（默认 omp-<线程号> 或 thread-<tid>）
+bool trace_write(const char* role);     // 写出全部线程的事件；未开启时直接返回 true
+
+static inline uint64_t trace_now()
+{
+    return __rdtsc();
+}
+
+// 作用域内的一个阶段：构造时记下开始时间，析构时记录事件；name 为 nullptr 时不记录（条件追踪）
+struct TraceScope
+{
+    const char* name;
+    uint64_t arg;
+    uint64_t begin;
+
+    TraceScope(const char* n, uint64_t a) : name(g_traceEnabled ? n : nullptr), arg(a), begin(name ? trace_now() : 0) {}
+    ~TraceScope()
+    {
+        if (name != nullptr)
+            trace_record(name, begin, trace_now(), arg);
+    }
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// arg 为附带的数值（元素个数、字节数、轮次等），在 Chrome trace 的 args.n 中显示
+#define TRACE_SCOPE(name, arg) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)((name), (uint64_t)(arg))
@@ -0,0 +1,49 @@
+#pragma once
+
+/*
+    逐元素变换 f(x)：Sum/Max/排序都作用在 f(x) 上，默认为 log(sqrt(x))
+    每个变换是一个只含静态成员的结构体，各引擎以它为模板参数：
+    - name       名称（基准测试输出；--mode bench 用 --transform / PARDIST_TRANSFORM 按名称选择）
+    - monotonic  f 单调不减：排序时直接比较原始数据，比较处不必计算 f
+    - scale      加速内核把 f 写成 scale * inner(x)（scale > 0）：循环内只算 inner，
+                 Sum/Max 归约后乘一次 scale，键变换时每个元素乘一次
+    - reference  标量参考实现（libm），基础版本使用
+    inner 的向量/标量实现在 kernels.cpp 中按指令集编译（transform_inner 的重载），
+    这里不定义，以免不同指令集编译出的同名 inline 函数在链接时互相替换
+    新增变换：在这里加结构体和 TransformId，在 kernels.cpp 加 transform_inner 与内核表项
+*/
+
+#include <cmath>
+
+enum TransformId
+{
+    TRANSFORM_LOG_SQRT = 0,     // log(sqrt(x))，本项目的计算任务
+    TRANSFORM_SQRT = 1,         // sqrt(x)
+    TRANSFORM_SQUARE = 2,       // x * x（在实数上不单调，用来走“先变换再排序”的路径）
+    TRANSFORM_COUNT
+};
+
+// log(sqrt(x)) = 0.5 * log(x)，乘 0.5 是精确运算
+struct LogSqrtTransform
+{
+    static const char* name() { return "log_sqrt"; }
+    static const bool monotonic = true;
+    static constexpr float scale = 0.5f;
+    static float reference(float x) { return std::log(std::sqrt(x)); }
+};
+
+struct SqrtTransform
+{
+    static const char* name() { return "sqrt"; }
+    static const bool monotonic = true;
+    static constexpr float scale = 1.0f;
+    static float reference(float x) { return std::sqrt(x); }
+};
+
+struct SquareTransform
+{
+    static const char* name() { return "square"; }
+    static const bool monotonic = false;
+    static constexpr float scale = 1.0f;
+    static float reference(float x) { return x * x; }
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+/*
+    UDP 可靠传输层
+    - 控制消息：带序号，逐条确认，超时重传，接收端去重
+    - 大块数据：按 MTU 切分成数据包，滑动窗口 + 选择确认(SACK) + 选择重传，
+      接收端直接按偏移重组到预先登记的缓冲区
+    - 收发使用 sendmmsg/recvmmsg 批量系统调用；大块数据的数据包直接引用调用者的缓冲区，
+      可选 MSG_ZEROCOPY 让内核也不再复制（完成通知由接收线程从错误队列取回）
+    - 接收线程用 epoll 同时等待套接字和 eventfd：数据到达立即处理，transport_shutdown 写 eventfd 使其退出
+    - 每批包处理完（包括控制消息回调）后递增事件计数并唤醒等待者，上层不需要轮询
+*/
+
+#include <cstddef>
+#include <stdint.h>
+#include <atomic>
+#include <netinet/in.h>
+
+// 传输参数，默认值来自 network_config.h，可被环境变量覆盖：
+//   PARDIST_MTU       链路 MTU（决定每个数据包的负载大小）
+//   PARDIST_WINDOW    发送窗口（未确认的数据包个数上限）
+//   PARDIST_RTO_MS    重传超时
+//   PARDIST_LOSS_RATE 接收端注入的丢包率（0-1，仅用于测试）
+//   PARDIST_ZEROCOPY  1 表示大块数据用 MSG_ZEROCOPY 发送（负载越大越划算，回环上配合大 MTU 使用）
+//   PARDIST_WAIT_TIMEOUT_MS 上层等待对端消息的超时，0 表示不超时
+struct TransportConfig
+{
+    size_t mtu;
+    uint32_t window;
+    int rto_ms;
+    double loss_rate;
+    bool zerocopy;
+    int wait_timeout_ms;
+};
+
+// 控制消息回调，在接收线程中执行，回调内不能调用阻塞的发送函数
+typedef void (*ControlHandler)(const struct sockaddr_in& from, const char* msg, size_t len);
+
+// 传输统计
+struct TransportStats
+{
+    uint64_t packets_sent;
+    uint64_t packets_retransmitted;
+    uint64_t packets_received;
+    uint64_t packets_dropped;   // 注入丢包
+    uint64_t bulk_bytes;        // transport_send_bulk 发送的字节数（不含重传）
+    uint64_t bulk_us;           // transport_send_bulk 的总用时
+    uint64_t zerocopy_sends;    // 以 MSG_ZEROCOPY 发出的数据包
+    uint64_t zerocopy_copied;   // 其中内核回退为复制的个数（例如回环上投递给本机套接字时）
+};
+
+// 初始化：绑定已创建的套接字，读取配置
+void transport_init(int sock);
+const TransportConfig& transport_config();
+TransportStats transport_stats();
+void transport_print_stats();
+
+// 接收线程主体：批量收包并分发，transport_shutdown 之后返回
+void transport_receive_loop(ControlHandler handler);
+
+// 通知接收线程退出（可在任意线程调用），之后由调用者 join 接收线程再关闭套接字
+void transport_shutdown();
+
+// 事件计数：控制消息交给回调或接收流有新数据到达后递增
+// 等待某个条件时先读计数，再检查条件，条件不满足时用读到的计数等待，不会漏掉中间的事件
+uint64_t transport_events();
+// 阻塞到事件计数不等于 seen；已经 shutdown 或 transport_cancel_waits 之后返回 false
+// timeout_ms 大于 0 时最多等待这么久，超时与事件到达一样返回 true，由调用者重新检查条件和时间
+bool transport_wait_event(uint64_t seen, int timeout_ms = 0);
+
+// 取消所有等待（可在任意线程、包括控制消息回调中调用）：之后 transport_wait_event 立即返回 false，
+// 用于本节点放弃测试时唤醒主线程；收发不受影响
+void transport_cancel_waits();
+
+// 可靠发送一条控制消息，阻塞到对端确认；超过重试上限返回 false
+bool transport_send_control(const struct sockaddr_in& peer, const void* msg, size_t len);
+
+// 可靠发送一段大块数据，阻塞到全部确认；stream 由收发双方约定
+// 零拷贝模式下还会等到内核释放对 data 的引用才返回，之后调用者可以立即修改或释放 data
+bool transport_send_bulk(const struct sockaddr_in& peer, uint32_t stream, const void* data, size_t bytes);
+
+// 接收端登记流的接收缓冲区；ready 以 elem_size 为单位发布已按序到达的前缀长度
+void transport_post_receive(uint32_t stream, void* buffer, size_t capacity, size_t elem_size,
+                            std::atomic<size_t>* ready);
+
+// 接收端结束一个流（之后到达的重传包直接回复完成确认）
+void transport_close_receive(uint32_t stream);
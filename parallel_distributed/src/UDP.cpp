@@ -1,11 +1,16 @@
 /*
     UDP通信服务器端和客户端函数实现
+    Server 作为协调节点：接受任意数量的 Worker（Client）加入，
+    每轮为自己和各 Worker 分配连续的全局下标区间，汇总 Sum/Max；
+    排序默认用样本排序（各节点按分割点直接交换数据，每个节点得到一段全局有序的键区间），
+    也可以退回汇总归并（各节点的排序结果流式发给 Server 多路归并）
 */
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <iostream>
 #include <cstdio>
@@ -14,86 +19,739 @@
 #include <chrono>
 #include <cmath>
 #include <limits>
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include <mutex>
+#include <stdint.h>
+#include <climits>
+#include <omp.h>
 #include "network_config.h"
+#include "transport.hpp"
+#include "protocol.hpp"
 #include "common.hpp"
+#include "input.hpp"
+#include "kernels.hpp"
+#include "bench.hpp"
+#include "trace.hpp"
 
 using namespace std;
 
-const size_t local_data_size_basic = DATANUM; // 基础版本处理全部数据
-const size_t local_data_size_speedup_server = DATANUM * portion_server; // 加速版本服务器端处理数据量
-const size_t local_data_size_speedup_client = DATANUM * (1 - portion_server); // 加速版本客户端处理数据量
-
 // Global socket and address info
 int g_socket;
-struct sockaddr_in g_peerAddr;
+struct sockaddr_in g_peerAddr; // Client: Server 地址
 socklen_t g_peerLen;
 bool g_isServer = false;
-int g_run_times = 0; // Number of test rounds
-bool g_basicDone = false; // Whether basic version is completed
-bool g_peerBasicDone = false; // Whether peer's basic version is completed
+std::atomic<int> g_run_times(0); // Number of test rounds（接收线程在 JOIN/ASSIGN 中更新）
+std::atomic<int> g_round(0); // 当前轮次：主线程写入（release），接收线程的处理函数据此过滤过期消息（acquire）
 
-// Client results for speedup version
-bool g_clientResultsReady = false;
-float g_clientSum = 0.0f;
-float g_clientMax = 0.0f;
-float* g_clientSortedData = nullptr; // Will store Client's sorted 64M data
+// Server 的地址与端口，默认取 network_config.h，可由命令行 --server/--port 覆盖
+const char* g_serverIp = SERVER_IP;
+int g_serverPort = SERVER_PORT;
 
-// Receive message thread function
-void* receive_thread(void* arg)
+// Server 端记录的每个 Worker 的状态
+struct WorkerState
+{
+    struct sockaddr_in addr;
+    int id;
+    size_t start;                   // 本轮全局下标 [start, start + size)
+    size_t size;
+    std::atomic<bool> results_ready; // 接收线程置位，主线程等待
+    double sum;
+    SumFixed sum_fixed;             // SUM_EXACT 模式下的定点和
+    double max;
+    double rate;                    // 估计吞吐量（元素/秒），由启动标定初始化、逐轮修正
+    double elapsed_ms;              // 本轮计算+传输用时
+    double compute_ms;              // 本轮本地计算用时（不含等待与传输），用于修正吞吐量
+    float* sorted;                  // 排序结果接收缓冲区，跨轮复用
+    size_t sorted_capacity;
+    std::atomic<size_t> sorted_count; // 已按序到达的元素个数，供流式归并读取
+    bool lost;                      // 控制消息发送失败（只由主线程读写），中止测试时不再通知它
+    std::atomic<bool> failed;       // 报告了本轮失败（随后即退出），中止测试时同样不再通知它
+};
+
+int g_expectedWorkers = 0;
+double g_serverRate = 0.0; // Server 自身的估计吞吐量
+int g_sumMode = SUM_FAST;  // 求和精度模式，Server 在 MSG_ASSIGN 中下发给 Worker
+int g_distSort = DIST_SORT_SAMPLE; // 分布式排序方式，同样由 Server 决定
+std::vector<WorkerState*> g_workers;
+std::mutex g_workersMutex;
+
+// Client 端收到的本轮分配
+AssignPayload g_assign;
+std::atomic<int> g_assignRound(0); // 写入 g_assign 之后再发布轮次
+
+// 样本排序的节点状态（Server 和 Worker 共用），节点编号：Server 为 0，Worker i 为 i + 1
+// 控制消息处理函数只写入数据并更新计数，主线程用 wait_until 等待（由传输层的事件计数唤醒）
+struct SampleSortState
+{
+    // 节点数与本节点编号由一个线程写入（Server 主线程、Worker 的 on_peers/主线程），接收线程的处理函数读取，
+    // 写入用 release、处理函数用 acquire
+    std::atomic<int> nodes;                             // 参与节点数
+    std::atomic<int> self;                              // 本节点编号
+    struct sockaddr_in peers[SAMPLE_SORT_MAX_NODES];    // 各节点地址
+    std::atomic<int> peers_ready;
+
+    float samples[SAMPLE_SORT_MAX_NODES][SAMPLES_PER_NODE]; // Server: 各节点的样本
+    uint32_t sample_counts[SAMPLE_SORT_MAX_NODES];
+    std::atomic<int> samples_received;
+
+    float splitters[SAMPLE_SORT_MAX_NODES - 1];
+    std::atomic<int> splitters_round;                   // Worker: 已收到分割点的轮次
+
+    size_t offers[SAMPLE_SORT_MAX_NODES];               // 各源节点将发来的键个数
+    std::atomic<int> offers_received;
+    std::atomic<bool> pulled[SAMPLE_SORT_MAX_NODES];    // 目的节点已登记接收缓冲区
+    std::atomic<size_t> arrived[SAMPLE_SORT_MAX_NODES]; // 各源节点已到达的键个数
+
+    RangePayload ranges[SAMPLE_SORT_MAX_NODES];         // Server: 各节点上报的排序区间
+    std::atomic<int> ranges_received;
+};
+SampleSortState g_sample;
+
+static WorkerState* find_worker(const struct sockaddr_in& from)
 {
-    char buffer[256];
-    
-    while (1)
+    std::lock_guard<std::mutex> lock(g_workersMutex);
+    for (size_t i = 0; i < g_workers.size(); i++)
     {
-        memset(buffer, 0, sizeof(buffer));
-        int recv_len = recvfrom(g_socket, buffer, sizeof(buffer) - 1, 0, 
-                               (struct sockaddr*)&g_peerAddr, &g_peerLen);
-        if (recv_len > 0)
+        if (g_workers[i]->addr.sin_addr.s_addr == from.sin_addr.s_addr &&
+            g_workers[i]->addr.sin_port == from.sin_port)
         {
-            buffer[recv_len] = '\0';
-            
-            // Check if it's a signal message
-            if (strcmp(buffer, "BASIC_DONE") == 0)
-            {
-                printf("[Received peer basic version done signal]\n");
-                g_peerBasicDone = true;
-            }
-            else if (strncmp(buffer, "RUN_TIMES:", 10) == 0)
-            {
-                // Received run times signal
-                g_run_times = atoi(buffer + 10);
-                printf("[Received run_times: %d]\n", g_run_times);
-            }
-            else if (strncmp(buffer, "RESULT_SUM:", 11) == 0)
-            {
-                // Received Client's sum result
-                g_clientSum = atof(buffer + 11);
-                printf("[Received Client sum: %f]\n", g_clientSum);
-            }
-            else if (strncmp(buffer, "RESULT_MAX:", 11) == 0)
-            {
-                // Received Client's max result
-                g_clientMax = atof(buffer + 11);
-                printf("[Received Client max: %f]\n", g_clientMax);
-            }
-            else if (strcmp(buffer, "RESULTS_READY") == 0)
+            return g_workers[i];
+        }
+    }
+    return NULL;
+}
+
+// Worker：Server 已经中止测试（MSG_ABORT）或控制消息发不到 Server，本地失败不再向它报告
+std::atomic<bool> g_serverGone(false);
+
+// 测试中止：控制消息发送失败（对端失联）、等待超时或 Worker 收到 MSG_ABORT 后置位，同时取消传输层的等待，
+// 主线程正在进行的 wait_until 立即返回 false，主循环随即结束测试
+std::atomic<bool> g_aborted(false);
+
+// 可在任意线程调用（包括控制消息处理函数），只打印第一次的原因
+static void abort_test(const char* reason)
+{
+    if (!g_aborted.exchange(true))
+        printf("[Abort] %s，结束测试\n", reason);
+    transport_cancel_waits();
+}
+
+// 可靠发送一条二进制控制消息；超过重传上限时视为对端失联（Server 记下失联的Worker），中止测试并返回 false
+static bool send_control_message(const struct sockaddr_in& peer, uint8_t type, const void* payload, uint32_t length)
+{
+    char buffer[sizeof(MessageHeader) + PROTOCOL_MAX_PAYLOAD];
+    size_t len = encode_message(buffer, type, g_round.load(std::memory_order_relaxed), payload, length);
+    if (transport_send_control(peer, buffer, len))
+        return true;
+    if (g_isServer)
+    {
+        WorkerState* w = find_worker(peer);
+        if (w != NULL)
+            w->lost = true;
+    }
+    else if (peer.sin_addr.s_addr == g_peerAddr.sin_addr.s_addr && peer.sin_port == g_peerAddr.sin_port)
+    {
+        g_serverGone = true;
+    }
+    char reason[96];
+    snprintf(reason, sizeof(reason), "%s 未被 %s:%d 确认", message_type_name(type), inet_ntoa(peer.sin_addr),
+             ntohs(peer.sin_port));
+    abort_test(reason);
+    return false;
+}
+
+// 测试中止后不再发送普通消息（对端可能已经退出，每条都要等到重传上限才失败），
+// 只有 abort_workers / report_round_failure 直接用 send_control_message 发出中止通知
+static bool send_message_to(const struct sockaddr_in& peer, uint8_t type,
+                            const void* payload = NULL, uint32_t length = 0)
+{
+    if (g_aborted)
+        return false;
+    return send_control_message(peer, type, payload, length);
+}
+
+static bool send_message(uint8_t type, const void* payload = NULL, uint32_t length = 0)
+{
+    return send_message_to(g_peerAddr, type, payload, length);
+}
+
+static bool send_value(uint8_t type, double value)
+{
+    return send_message(type, &value, sizeof(value));
+}
+
+static double read_double(const char* payload)
+{
+    double value;
+    memcpy(&value, payload, sizeof(value));
+    return value;
+}
+
+// 阻塞到 pred() 成立：接收线程每处理完一批包都会唤醒等待者，再重新检查条件
+// 先读事件计数再检查条件，检查之后发生的事件会使计数变化，等待立即返回
+// what 为追踪中显示的等待原因（等待对端的时间即追踪中的这些区间）
+// 条件成立返回 true；超过 timeout_ms（0 为不超时）、测试已中止或传输层已关闭时返回 false，超时也会中止测试
+template <typename Pred>
+static bool wait_for(const char* what, int timeout_ms, Pred pred)
+{
+    TRACE_SCOPE(what, g_round.load(std::memory_order_relaxed));
+    const std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true)
+    {
+        uint64_t seen = transport_events();
+        if (pred())
+            return true;
+        int remaining = 0;
+        if (timeout_ms > 0)
+        {
+            remaining = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (remaining <= 0)
             {
-                // All Client results received
-                g_clientResultsReady = true;
-                printf("[Client results ready]\n");
+                char reason[96];
+                snprintf(reason, sizeof(reason), "%s 等待超过 %d ms", what, timeout_ms);
+                abort_test(reason);
+                return false;
             }
-            else
+        }
+        if (!transport_wait_event(seen, remaining))
+            return pred();
+    }
+}
+
+// 按配置的超时等待（PARDIST_WAIT_TIMEOUT_MS）
+template <typename Pred>
+static bool wait_until(const char* what, Pred pred)
+{
+    return wait_for(what, transport_config().wait_timeout_ms, pred);
+}
+
+static size_t worker_count()
+{
+    std::lock_guard<std::mutex> lock(g_workersMutex);
+    return g_workers.size();
+}
+
+// ===== 控制消息处理函数（在接收线程中执行） =====
+
+static void on_join(const struct sockaddr_in& from, const MessageHeader& header, const char* payload)
+{
+    JoinPayload join;
+    memcpy(&join, payload, sizeof(join));
+    int32_t run_times = join.run_times;
+    NodeThroughput throughput;
+    throughput.sum_rate = join.sum_rate;
+    throughput.max_rate = join.max_rate;
+    throughput.sort_rate = join.sort_rate;
+
+    std::lock_guard<std::mutex> lock(g_workersMutex);
+    if ((int)g_workers.size() >= g_expectedWorkers)
+    {
+        printf("[Server] Worker %s:%d 加入被忽略：已达到 %d 个Worker\n",
+               inet_ntoa(from.sin_addr), ntohs(from.sin_port), g_expectedWorkers);
+        return;
+    }
+
+    WorkerState* w = new WorkerState;
+    w->addr = from;
+    w->id = (int)g_workers.size();
+    w->start = 0;
+    w->size = 0;
+    w->results_ready = false;
+    w->sum = 0.0;
+    w->sum_fixed = 0;
+    w->max = 0.0;
+    w->rate = combined_rate(throughput);
+    w->elapsed_ms = 0.0;
+    w->compute_ms = 0.0;
+    w->sorted = nullptr;
+    w->sorted_capacity = 0;
+    w->sorted_count = 0;
+    w->lost = false;
+    w->failed = false;
+    g_workers.push_back(w);
+
+    // 以第一个加入的Worker请求的轮数为准
+    if (g_run_times == 0)
+    {
+        g_run_times = run_times;
+    }
+    else if (run_times != g_run_times)
+    {
+        printf("[Server] Worker %d 请求 %d 轮，按 %d 轮执行\n", w->id, run_times, g_run_times.load());
+    }
+    printf("[Worker %d joined from %s:%d, %zu/%d, 标定吞吐量 %.1f M/s]\n", w->id, inet_ntoa(from.sin_addr),
+           ntohs(from.sin_port), g_workers.size(), g_expectedWorkers, w->rate / 1e6);
+}
+
+static void on_assign(const struct sockaddr_in& from, const MessageHeader& header, const char* payload)
+{
+    memcpy(&g_assign, payload, sizeof(g_assign));
+    g_run_times = g_assign.run_times;
+    printf("[Received assignment: worker %d, index [%llu, %llu)]\n", g_assign.worker_id,
+           (unsigned long long)g_assign.start, (unsigned long long)(g_assign.start + g_assign.size));
+    g_assignRound = header.round;
+}
+
+// 消息是否属于当前轮次
+static bool is_current_round(const MessageHeader& header)
+{
+    return header.round == g_round.load(std::memory_order_acquire);
+}
+
+static void on_result_sum(const struct sockaddr_in& from, const MessageHeader& header, const char* payload)
+{
+    WorkerState* w = find_worker(from);
+    if (w == NULL || !is_current_round(header))
+        return;
+    SumPayload result;
+    memcpy(&result, payload, sizeof(result));
+    w->sum = result.sum;
+    w->sum_fixed = result.fixed;
+    printf("[Received Worker %d sum: %.17g]\n", w->id, w->sum);
+}
+
+static void on_result_max(const struct sockaddr_in& from, const MessageHeader& header, const char* payload)
+{
+    WorkerState* w = find_worker(from);
+    if (w == NULL || !is_current_round(header))
+        return;
+    w->max = read_double(payload);
+    printf("[Received Worker %d max: %.17g]\n", w->id, w->max);
+}
+
+static void on_results_ready(const struct sockaddr_in& from, const MessageHeader& header, const char* payload)
+{
+    WorkerState* w = find_worker(from);
+    if (w == NULL)
+        return;
+    ReadyPayload ready;
+    memcpy(&ready, payload, sizeof(ready));
+    // 失败报告不按轮次过滤：Worker 发出后已经退出测试，无论 Server 处在哪一轮都要中止
+    if (ready.failed != 0)
+    {
+        char reason[64];
+        snprintf(reason, sizeof(reason), "Worker %d 报告本轮失败", w->id);
+        w->failed = true;
+        abort_test(reason);
+        return;
+    }
+    if (!is_current_round(header))
+        return;
+    w->elapsed_ms = ready.elapsed_ms;
+    w->compute_ms = ready.compute_ms;
+    w->results_ready = true;
+    printf("[Worker %d results ready, %.2f ms（本地计算 %.2f ms）]\n", w->id, w->elapsed_ms, w->compute_ms);
+}
+
+static void on_peers(const struct sockaddr_in& from, const MessageHeader& header, const char* payload)
+{
+    PeersPayload peers;
+    memcpy(&peers, payload, sizeof(peers));
+    const int nodes = (int)std::min<uint32_t>(peers.count, SAMPLE_SORT_MAX_NODES);
+    g_sample.peers[0] = g_peerAddr;
+    for (int j = 1; j < nodes; j++)
+    {
+        memset(&g_sample.peers[j], 0, sizeof(g_sample.peers[j]));
+        g_sample.peers[j].sin_family = AF_INET;
+        g_sample.peers[j].sin_addr.s_addr = peers.peers[j].ip;
+        g_sample.peers[j].sin_port = peers.peers[j].port;
+    }
+    g_sample.nodes.store(nodes, std::memory_order_release);
+    g_sample.peers_ready = 1;
+}
+
+static int sample_nodes()
+{
+    return g_sample.nodes.load(std::memory_order_acquire);
+}
+
+static int sample_self()
+{
+    return g_sample.self.load(std::memory_order_acquire);
+}
+
+static void on_samples(const struct sockaddr_in& from, const MessageHeader& header, const char* payload)
+{
+    SamplesPayload samples;
+    memcpy(&samples, payload, sizeof(samples));
+    if (!is_current_round(header) || samples.node == 0 || samples.node >= (uint32_t)sample_nodes())
+        return;
+    g_sample.sample_counts[samples.node] = std::min<uint32_t>(samples.count, SAMPLES_PER_NODE);
+    memcpy(g_sample.samples[samples.node], samples.samples, sizeof(samples.samples));
+    g_sample.samples_received++;
+}
+
+static void on_splitters(const struct sockaddr_in& from, const MessageHeader& header, const char* payload)
+{
+    SplittersPayload splitters;
+    memcpy(&splitters, payload, sizeof(splitters));
+    if (!is_current_round(header) || splitters.count + 1 != (uint32_t)sample_nodes())
+        return;
+    memcpy(g_sample.splitters, splitters.splitters, splitters.count * sizeof(float));
+    g_sample.splitters_round = header.round;
+}
+
+static void on_exchange_offer(const struct sockaddr_in& from, const MessageHeader& header, const char* payload)
+{
+    ExchangePayload offer;
+    memcpy(&offer, payload, sizeof(offer));
+    if (!is_current_round(header) || offer.src >= (uint32_t)sample_nodes() || (int)offer.dst != sample_self())
+        return;
+    g_sample.offers[offer.src] = offer.count;
+    g_sample.offers_received++;
+}
+
+static void on_exchange_pull(const struct sockaddr_in& from, const MessageHeader& header, const char* payload)
+{
+    ExchangePayload pull;
+    memcpy(&pull, payload, sizeof(pull));
+    if (!is_current_round(header) || (int)pull.src != sample_self() || pull.dst >= (uint32_t)sample_nodes())
+        return;
+    g_sample.pulled[pull.dst] = true;
+}
+
+static void on_abort(const struct sockaddr_in& from, const MessageHeader& header, const char* payload)
+{
+    g_serverGone = true;
+    abort_test("收到 Server 的 MSG_ABORT");
+}
+
+static void on_range_summary(const struct sockaddr_in& from, const MessageHeader& header, const char* payload)
+{
+    RangePayload range;
+    memcpy(&range, payload, sizeof(range));
+    if (!is_current_round(header) || range.node == 0 || range.node >= (uint32_t)sample_nodes())
+        return;
+    g_sample.ranges[range.node] = range;
+    g_sample.ranges_received++;
+}
+
+// 消息处理表：按消息类型索引，min_length 为负载的最小长度
+struct MessageHandlerEntry
+{
+    void (*handler)(const struct sockaddr_in& from, const MessageHeader& header, const char* payload);
+    uint32_t min_length;
+};
+
+static const MessageHandlerEntry g_messageHandlers[MSG_TYPE_COUNT] = {
+    { NULL,             0 },
+    { on_join,          sizeof(JoinPayload) },    // MSG_JOIN
+    { on_assign,        sizeof(AssignPayload) },  // MSG_ASSIGN
+    { on_result_sum,    sizeof(SumPayload) },     // MSG_RESULT_SUM
+    { on_result_max,    sizeof(double) },         // MSG_RESULT_MAX
+    { on_results_ready, sizeof(ReadyPayload) },   // MSG_RESULTS_READY
+    { on_peers,         sizeof(PeersPayload) },   // MSG_PEERS
+    { on_samples,       sizeof(SamplesPayload) }, // MSG_SAMPLES
+    { on_splitters,     sizeof(SplittersPayload) }, // MSG_SPLITTERS
+    { on_exchange_offer, sizeof(ExchangePayload) }, // MSG_EXCHANGE_OFFER
+    { on_exchange_pull, sizeof(ExchangePayload) }, // MSG_EXCHANGE_PULL
+    { on_range_summary, sizeof(RangePayload) },   // MSG_RANGE_SUMMARY
+    { on_abort,         0 },                      // MSG_ABORT
+};
+
+// Control message dispatcher, called from the receive thread
+static void on_control_message(const struct sockaddr_in& from, const char* msg, size_t len)
+{
+    MessageHeader header;
+    const char* payload;
+    if (!decode_message(msg, len, &header, &payload))
+    {
+        printf("[Peer] Malformed or incompatible message (%zu bytes)\n", len);
+        return;
+    }
+
+    if (header.type >= MSG_TYPE_COUNT || g_messageHandlers[header.type].handler == NULL ||
+        header.length < g_messageHandlers[header.type].min_length)
+    {
+        printf("[Peer] Unhandled message %s (type %u, %u bytes)\n",
+               message_type_name(header.type), header.type, header.length);
+        return;
+    }
+    g_messageHandlers[header.type].handler(from, header, payload);
+}
+
+// Receive message thread function
+void* receive_thread(void* arg)
+{
+    trace_set_thread_name("recv");
+    transport_receive_loop(on_control_message);
+    return NULL;
+}
+
+// 按估计吞吐量划分本轮数据，全局下标依次为 Server、Worker 0、Worker 1 ...，各段连续
+// 返回 Server 自己处理的元素个数
+static size_t assign_partitions(size_t total)
+{
+    const size_t n = g_workers.size();
+    std::vector<double> rates(n + 1);
+    std::vector<size_t> sizes(n + 1);
+    rates[0] = g_serverRate;
+    for (size_t i = 0; i < n; i++)
+    {
+        rates[i + 1] = g_workers[i]->rate;
+    }
+    balance_partition(rates.data(), (int)(n + 1), total, sizes.data());
+
+    printf("[Balance] Server %.1f%%", 100.0 * sizes[0] / total);
+    size_t start = sizes[0];
+    for (size_t i = 0; i < n; i++)
+    {
+        WorkerState* w = g_workers[i];
+        w->start = start;
+        w->size = sizes[i + 1];
+        start += w->size;
+        printf(", Worker%d %.1f%%", w->id, 100.0 * w->size / total);
+    }
+    printf("\n");
+    return sizes[0];
+}
+
+// 本轮排序结果的流编号：高16位为轮次，低16位为 Worker 编号
+static uint32_t sort_stream_id(int round, int worker_id)
+{
+    return ((uint32_t)round << 16) | (uint32_t)worker_id;
+}
+
+// 样本排序交换的流编号：最高位置 1，与汇总归并的流区分；其下为轮次、源节点、目的节点（各 6 位）
+static uint32_t exchange_stream_id(int round, int src, int dst)
+{
+    return 0x80000000u | ((uint32_t)round << 12) | ((uint32_t)src << 6) | (uint32_t)dst;
+}
+
+static int dist_sort_from_env()
+{
+    const char* mode = getenv("PARDIST_DIST_SORT");
+    if (mode == nullptr || strcmp(mode, "sample") == 0)
+        return DIST_SORT_SAMPLE;
+    if (strcmp(mode, "gather") == 0)
+        return DIST_SORT_GATHER;
+    printf("[Sort] 未知的 PARDIST_DIST_SORT=%s（可选 sample/gather），使用 sample\n", mode);
+    return DIST_SORT_SAMPLE;
+}
+
+static const char* dist_sort_name(int mode)
+{
+    return (mode == DIST_SORT_GATHER) ? "gather" : "sample";
+}
+
+// 每轮开始前（Server 下发分配前、Worker 上报样本前）清空上一轮的交换状态
+static void sample_sort_reset()
+{
+    g_sample.samples_received = 0;
+    g_sample.offers_received = 0;
+    g_sample.ranges_received = 0;
+    for (int j = 0; j < SAMPLE_SORT_MAX_NODES; j++)
+    {
+        g_sample.offers[j] = 0;
+        g_sample.pulled[j] = false;
+        g_sample.arrived[j] = 0;
+    }
+}
+
+// 从 begin 到现在经过的毫秒数
+static double ms_since(const struct timespec& begin)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - begin.tv_sec) * 1000.0 + (now.tv_nsec - begin.tv_nsec) / 1e6;
+}
+
+// 按分割点把本节点的键分发给所有节点，并接收其他节点发来的键
+// 1. 分桶后向每个节点发 OFFER（键个数，可以为 0）
+// 2. 收齐所有 OFFER 后登记接收缓冲区，再向有数据的源节点发 PULL
+// 3. 收到目的节点的 PULL 后才开始大块发送（传输层会丢弃未登记流的数据包）
+// 返回本节点负责的全部键（未排序，位于 ARENA_RANGE），个数写入 *count；分桶用时累加到 *compute_ms；
+// 发送失败或等待超时时中止测试并返回 nullptr
+static float* exchange_keys(int round, const float keys[], size_t n, size_t* count, double* compute_ms)
+{
+    TRACE_SCOPE("exchange", n);
+    const int nodes = g_sample.nodes;
+    const int self = g_sample.self;
+
+    float* buckets = arena_floats(ARENA_SCRATCH_A, n);
+    size_t send_counts[SAMPLE_SORT_MAX_NODES];
+    size_t send_offsets[SAMPLE_SORT_MAX_NODES];
+    {
+        TRACE_SCOPE("partition_keys", n);
+        struct timespec begin;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        partition_by_splitters(keys, n, g_sample.splitters, nodes, buckets, send_counts);
+        *compute_ms += ms_since(begin);
+    }
+    size_t offset = 0;
+    for (int j = 0; j < nodes; j++)
+    {
+        send_offsets[j] = offset;
+        offset += send_counts[j];
+    }
+
+    for (int j = 0; j < nodes; j++)
+    {
+        if (j == self)
+            continue;
+        ExchangePayload offer;
+        offer.src = self;
+        offer.dst = j;
+        offer.count = send_counts[j];
+        if (!send_message_to(g_sample.peers[j], MSG_EXCHANGE_OFFER, &offer, sizeof(offer)))
+            return nullptr;
+    }
+    if (!wait_until("wait_offers", [nodes] { return g_sample.offers_received >= nodes - 1; }))
+        return nullptr;
+
+    // 接收缓冲区按源节点顺序连续存放，本节点自己的桶直接复制
+    size_t recv_offsets[SAMPLE_SORT_MAX_NODES];
+    size_t total = 0;
+    for (int j = 0; j < nodes; j++)
+    {
+        recv_offsets[j] = total;
+        total += (j == self) ? send_counts[j] : g_sample.offers[j];
+    }
+    float* received = arena_floats(ARENA_RANGE, total);
+    memcpy(received + recv_offsets[self], buckets + send_offsets[self], send_counts[self] * sizeof(float));
+
+    for (int j = 0; j < nodes; j++)
+    {
+        if (j == self || g_sample.offers[j] == 0)
+            continue;
+        transport_post_receive(exchange_stream_id(round, j, self), received + recv_offsets[j],
+                               g_sample.offers[j] * sizeof(float), sizeof(float), &g_sample.arrived[j]);
+        ExchangePayload pull;
+        pull.src = j;
+        pull.dst = self;
+        pull.count = g_sample.offers[j];
+        if (!send_message_to(g_sample.peers[j], MSG_EXCHANGE_PULL, &pull, sizeof(pull)))
+            return nullptr;
+    }
+
+    // 按 PULL 到达的顺序发送，对端先准备好的先发
+    int pending = 0;
+    bool sent[SAMPLE_SORT_MAX_NODES] = { false };
+    for (int j = 0; j < nodes; j++)
+    {
+        if (j != self && send_counts[j] > 0)
+            pending++;
+        else
+            sent[j] = true;
+    }
+    while (pending > 0)
+    {
+        bool pulled = wait_until("wait_pull", [&] {
+            for (int j = 0; j < nodes; j++)
+                if (!sent[j] && g_sample.pulled[j])
+                    return true;
+            return false;
+        });
+        if (!pulled)
+            return nullptr;
+        for (int j = 0; j < nodes; j++)
+        {
+            if (!sent[j] && g_sample.pulled[j])
             {
-                printf("\n[Peer]: %s\n", buffer);
+                if (!transport_send_bulk(g_sample.peers[j], exchange_stream_id(round, self, j),
+                                         buckets + send_offsets[j], send_counts[j] * sizeof(float)))
+                {
+                    char reason[64];
+                    snprintf(reason, sizeof(reason), "向节点 %d 发送键超时", j);
+                    abort_test(reason);
+                    return nullptr;
+                }
+                sent[j] = true;
+                pending--;
             }
         }
     }
-    return NULL;
+
+    for (int j = 0; j < nodes; j++)
+    {
+        if (j == self || g_sample.offers[j] == 0)
+            continue;
+        bool arrived = wait_until("wait_exchange_data", [j] { return g_sample.arrived[j] >= g_sample.offers[j]; });
+        transport_close_receive(exchange_stream_id(round, j, self));
+        if (!arrived)
+            return nullptr;
+    }
+
+    *count = total;
+    return received;
+}
+
+// 样本排序的本地部分：取样之后等待分割点、交换、排序本节点的键区间
+// 返回排好序的键（位于 ARENA_RANGE，下一轮复用），个数写入 *count；分桶与排序的用时累加到 *compute_ms，
+// 等待分割点和其他节点的时间不计入；交换失败返回 nullptr
+static float* sample_sort_local(int round, const float keys[], size_t n, size_t* count, double* compute_ms)
+{
+    float* range = exchange_keys(round, keys, n, count, compute_ms);
+    if (range == nullptr)
+        return nullptr;
+    struct timespec begin;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    sortKeys(sort_backend(), range, *count, arena_floats(ARENA_SCRATCH_B, *count));
+    *compute_ms += ms_since(begin);
+    return range;
+}
+
+static RangePayload summarize_range(const float range[], size_t count)
+{
+    TRACE_SCOPE("verify_range", count);
+    RangePayload summary;
+    summary.node = g_sample.self;
+    summary.sorted = std::is_sorted(range, range + count) ? 1 : 0;
+    summary.count = count;
+    summary.first = (count > 0) ? range[0] : 0.0f;
+    summary.last = (count > 0) ? range[count - 1] : 0.0f;
+    return summary;
+}
+
+// Server：测试中止后通知仍然可达的Worker，使它们不必等到超时
+static void abort_workers()
+{
+    for (size_t i = 0; i < g_workers.size(); i++)
+    {
+        if (!g_workers[i]->lost && !g_workers[i]->failed)
+            send_control_message(g_workers[i]->addr, MSG_ABORT, NULL, 0);
+    }
 }
 
+void set_server_address(const char* ip, int port)
+{
+    if (ip != nullptr)
+        g_serverIp = ip;
+    if (port > 0)
+        g_serverPort = port;
+}
 
+// 交互式输入一个正整数（上限 limit）
+static int prompt_positive(const char* prompt, int limit)
+{
+    printf("%s", prompt);
+    int value;
+    while (true)
+    {
+        cin >> value;
+        if (cin.good() && value > 0 && value < limit)
+        {
+            return value;
+        }
+        printf("Please enter a valid positive integer: ");
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    }
+}
+
+static BenchSeries make_series(const char* name, size_t elements)
+{
+    BenchSeries s;
+    s.name = name;
+    s.elements = elements;
+    return s;
+}
 
-void run_server()
+void run_server(int workers, int warmup, const BenchOutput* report)
 {
     g_isServer = true;
     g_socket = socket(AF_INET, SOCK_DGRAM, 0);
@@ -101,12 +759,12 @@ void run_server()
     {
         printf("Can't create a socket! Quitting\n");
         return;
-    }   
+    }
     printf("Socket Created.\n");
 
     struct sockaddr_in local;
     local.sin_family = AF_INET;
-    local.sin_port = htons(SERVER_PORT);
+    local.sin_port = htons(g_serverPort);
     local.sin_addr.s_addr = INADDR_ANY;
 
     if (bind(g_socket, (struct sockaddr*)&local, sizeof(local)) < 0)
@@ -116,152 +774,446 @@ void run_server()
         return;
     }
 
-    printf("Server listening on port %d...\n", SERVER_PORT);
-    printf("Waiting for Client to send run times...\n\n");
-    
-    g_peerLen = sizeof(g_peerAddr);
-    
+    // 参与计算的Worker数量：命令行未指定时交互输入
+    g_expectedWorkers = (workers > 0) ? workers : prompt_positive("\n请输入Worker节点数量: ", 65536);
+
+    transport_init(g_socket);
+    g_sumMode = sum_mode_from_env();
+    printf("[Sum] 求和模式: %s\n", sum_mode_name(g_sumMode));
+
+    // 输入数据的全局元素个数（合成数据为 DATANUM，文件输入由文件大小决定）
+    const size_t total = input_total();
+    const size_t local_data_size_basic = total; // 基础版本处理全部数据
+
+    // 标定本机吞吐量，作为第一轮划分的依据
+    g_serverRate = combined_rate(calibrate_throughput(std::min<size_t>(CALIBRATION_SAMPLE, DATANUM)));
+
+    printf("Server listening on port %d...\n", g_serverPort);
+    printf("Waiting for %d Worker(s) to join...\n\n", g_expectedWorkers);
+
     // Create receive thread
     pthread_t recv_thread;
     pthread_create(&recv_thread, NULL, receive_thread, NULL);
-    
-    // Wait for run times
-    while (g_run_times == 0)
+
+    // Wait for all workers（Worker 可能很久之后才启动，不设超时）
+    wait_for("wait_join", 0, [] { return (int)worker_count() >= g_expectedWorkers; });
+
+    // 决定分布式排序方式；样本排序的控制消息按最多 SAMPLE_SORT_MAX_NODES 个节点设计
+    g_distSort = dist_sort_from_env();
+    if (g_distSort == DIST_SORT_SAMPLE && g_workers.size() + 1 > SAMPLE_SORT_MAX_NODES)
     {
-        usleep(100000); // Wait for run times
+        printf("[Sort] 节点数 %zu 超过样本排序上限 %d，改用汇总归并\n", g_workers.size() + 1, SAMPLE_SORT_MAX_NODES);
+        g_distSort = DIST_SORT_GATHER;
     }
-    
+    printf("[Sort] 分布式排序: %s\n", dist_sort_name(g_distSort));
+
+    // 样本排序时节点之间直接交换数据，先把所有节点的地址发给每个Worker
+    if (g_distSort == DIST_SORT_SAMPLE)
+    {
+        PeersPayload peers;
+        memset(&peers, 0, sizeof(peers));
+        peers.count = (uint32_t)g_workers.size() + 1;
+        g_sample.self.store(0, std::memory_order_release);
+        g_sample.nodes.store((int)peers.count, std::memory_order_release);
+        for (size_t i = 0; i < g_workers.size(); i++)
+        {
+            g_sample.peers[i + 1] = g_workers[i]->addr;
+            peers.peers[i + 1].ip = g_workers[i]->addr.sin_addr.s_addr;
+            peers.peers[i + 1].port = g_workers[i]->addr.sin_port;
+        }
+        for (size_t i = 0; i < g_workers.size() && !g_aborted; i++)
+        {
+            send_message_to(g_workers[i]->addr, MSG_PEERS, &peers, sizeof(peers));
+        }
+    }
+
     printf("\n========================================\n");
-    printf("Ready! 开始 %d 轮测试\n", g_run_times);
+    printf("Ready! %d 个Worker，开始 %d 轮测试\n", g_expectedWorkers, g_run_times.load());
     printf("========================================\n\n");
-    
+
     // Track total times for averaging
     double total_basic_time = 0.0;
     double total_speedup_time = 0.0;
-    
-    // 每一轮测试都进行一次基础版和加速版
-    for (int round = 1; round <= g_run_times; round++)
+
+    // 逐轮用时（去掉前 warmup 轮），测试结束后写出报告
+    BenchSeries basic_sum_series = make_series("basic_sum", total);
+    BenchSeries basic_max_series = make_series("basic_max", total);
+    BenchSeries basic_sort_series = make_series("basic_sort", total);
+    BenchSeries basic_round_series = make_series("basic_round", total);
+    BenchSeries speedup_round_series = make_series("speedup_round", total);
+    if (report != nullptr && warmup >= g_run_times)
     {
-        // 第 round 轮测试卡斯
-        printf("\n========== Round %d/%d ==========\n", round, g_run_times);
-        
+        printf("[Bench] 预热轮数 %d 不少于总轮数 %d，报告中没有测量数据\n", warmup, g_run_times.load());
+    }
+
+    std::vector<SortedStream> streams(g_workers.size() + 1);
+    int completed = 0;
+
+    // 每一轮测试都进行一次基础版和加速版；任何一步失败都会置位 g_aborted，结束测试
+    for (int round = 1; round <= g_run_times && !g_aborted; round++)
+    {
+        // 第 round 轮测试
+        printf("\n========== Round %d/%d ==========\n", round, g_run_times.load());
+        g_round.store(round, std::memory_order_release);
+
         // ===== 1. BASIC VERSION =====
         printf("\n[Basic版本 - 只用Server端处理]\n");
 
-        data_init_and_shuffle(0, DATANUM); // 初始化数据，全部客户端处理
+        if (load_partition(0, total) == nullptr) // 加载全部数据，全部由Server处理
+        {
+            abort_test("Server 无法加载输入数据");
+            break;
+        }
 
         // 开始计时，基础版本处理全部数据
         struct timespec start, end;
 
         // 1. Sum计算和计时
         clock_gettime(CLOCK_MONOTONIC, &start);
-        float basic_sum = sumBasic(rawFloatData, local_data_size_basic);
+        float basic_sum;
+        {
+            TRACE_SCOPE("basic_sum", local_data_size_basic);
+            basic_sum = sumBasic(rawFloatData, local_data_size_basic);
+        }
         clock_gettime(CLOCK_MONOTONIC, &end);
         double basic_time_1= (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
         std::cout << "Basic Sum用时：" << basic_time_1 << " ms，结果：" << basic_sum << std::endl;
-        
+
         // 2. Max计算和计时
         clock_gettime(CLOCK_MONOTONIC, &start);
-        float basic_max = maxBasic(rawFloatData, local_data_size_basic);
+        float basic_max;
+        {
+            TRACE_SCOPE("basic_max", local_data_size_basic);
+            basic_max = maxBasic(rawFloatData, local_data_size_basic);
+        }
         clock_gettime(CLOCK_MONOTONIC, &end);
         double basic_time_2= (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
         std::cout << "Basic Max用时：" << basic_time_2 << " ms，结果：" << basic_max << std::endl;
 
         // 3. Sort计算和计时
-        float* basic_sorted = new float[local_data_size_basic];
+        float* basic_sorted = arena_floats(ARENA_RESULT, local_data_size_basic);
         clock_gettime(CLOCK_MONOTONIC, &start);
-        sortBasic(rawFloatData, local_data_size_basic, basic_sorted);
+        {
+            TRACE_SCOPE("basic_sort", local_data_size_basic);
+            sortBasic(rawFloatData, local_data_size_basic, basic_sorted);
+        }
         clock_gettime(CLOCK_MONOTONIC, &end);
-        delete[] basic_sorted;
         double basic_time_3= (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
         std::cout << "Basic Sort用时：" << basic_time_3 << " ms" << std::endl;
 
         double basic_time = basic_time_1 + basic_time_2 + basic_time_3;
-        total_basic_time += basic_time;
         printf("***本轮Basic版本用时: %.2f ms***\n\n", basic_time);
 
-        printf("[Server] Basic版本完成，通知Client...\n");
-        const char* basic_done_msg = "BASIC_DONE";
-        sendto(g_socket, basic_done_msg, strlen(basic_done_msg), 0, 
-              (struct sockaddr*)&g_peerAddr, g_peerLen);
-        g_basicDone = true;
-        
-        // Wait for Client confirmation
-        while (!g_peerBasicDone)
+        // ===== 2. SPEEDUP VERSION =====
+        printf("\n[SpeedUp版本 - Server和%zu个Worker同时处理]\n", g_workers.size());
+
+        // 划分全局下标，汇总归并时登记各Worker排序结果的接收缓冲区，然后下发分配（即本轮开始信号）
+        const size_t local_data_size_speedup_server = assign_partitions(total);
+        sample_sort_reset();
+        for (size_t i = 0; i < g_workers.size(); i++)
         {
-            usleep(10000); // 10ms
+            WorkerState* w = g_workers[i];
+            w->results_ready = false;
+            if (g_distSort == DIST_SORT_GATHER)
+            {
+                if (w->sorted_capacity < w->size)
+                {
+                    delete[] w->sorted;
+                    w->sorted = new float[w->size];
+                    w->sorted_capacity = w->size;
+                }
+                transport_post_receive(sort_stream_id(round, w->id), w->sorted, w->size * sizeof(float),
+                                       sizeof(float), &w->sorted_count);
+            }
+
+            AssignPayload assign;
+            assign.worker_id = w->id;
+            assign.run_times = g_run_times;
+            assign.stream = sort_stream_id(round, w->id);
+            assign.sum_mode = g_sumMode;
+            assign.start = w->start;
+            assign.size = w->size;
+            assign.dist_sort = g_distSort;
+            assign.reserved = 0;
+            if (!send_message_to(w->addr, MSG_ASSIGN, &assign, sizeof(assign)))
+                break;
         }
-        printf("[Server] Client ready, 开始本轮加速版本...\n");
-        
-        // Reset flags for next round
-        g_basicDone = false;
-        g_peerBasicDone = false;
-        
-        // ===== 2. SPEEDUP VERSION =====
-        printf("\n[SpeedUp版本 - Server和Client同时处理]\n");
-        
-        // Reset Client results flag
-        g_clientResultsReady = false;
-        
-        data_init_and_shuffle(0, local_data_size_speedup_server); // 初始化数据，Server处理前一部分
-
-        // Wait for Client to finish data generation
-        usleep(100000); // Wait 100ms for Client data generation
-        
-        // 开始计时
+        if (g_aborted)
+            break;
+        printf("[Server] 已向 %zu 个Worker下发本轮分配\n", g_workers.size());
+
+        // 开始计时：Server 的数据生成（或读入）也在流水线中，与计算重叠，计入本轮用时
         clock_gettime(CLOCK_MONOTONIC, &start);
-        
-        // 1. 求和
-        float server_sum = sumSpeedUp(rawFloatData, local_data_size_speedup_server);
+        const uint64_t round_begin = trace_now();
 
-        // 2. 求最大值
-        float server_max = maxSpeedUp(rawFloatData, local_data_size_speedup_server);
+        // 1+2. 逐块加载全局下标最前一段，同时完成求和、最大值与排序键计算
+        // 汇总归并时本节点的键就地排序，流水线顺带完成排序的成段阶段；样本排序的键交换之后才排序
+        float* keys = arena_floats(ARENA_KEYS, local_data_size_speedup_server);
+        const bool sort_in_place = (g_distSort == DIST_SORT_GATHER);
+        SortRuns runs;
+        if (sort_in_place)
+        {
+            runs = sort_runs_prepare(sort_backend(), keys, local_data_size_speedup_server,
+                                     arena_floats(ARENA_SCRATCH_B, local_data_size_speedup_server));
+        }
+        LocalResult local;
+        if (!run_local_pipeline(0, local_data_size_speedup_server, g_sumMode, keys, sort_in_place ? &runs : nullptr,
+                                &local))
+        {
+            // Worker 已经收到本轮分配，中止测试后由 abort_workers 通知它们
+            abort_test("Server 无法加载本节点的数据");
+            break;
+        }
+        // 本地计算用时（流水线与本地排序）用于修正吞吐量；等待其他节点的时间各节点相同，计入会使划分无法修正
+        double server_compute_ms = ms_since(start);
+        float server_sum = local.sum;
+        float server_max = local.max;
+        SumFixed server_fixed = local.fixed;
 
         // 3. 排序
-        float* server_sorted = new float[local_data_size_speedup_server];
-        sortSpeedUp(rawFloatData, local_data_size_speedup_server, server_sorted);
-
-        printf("[Server] Server端已完成，Sum结果: %f, Max结果: %f\n", server_sum, server_max);
-        
-        // Wait for Client results
-        printf("[Server] 等待Client结果...\n");
-        while (!g_clientResultsReady)
+        float* server_sorted = nullptr;
+        size_t server_sorted_count = 0;
+        if (g_distSort == DIST_SORT_SAMPLE)
+        {
+            // 取样，收齐各Worker的样本后按本轮划分比例选出分割点并广播
+            g_sample.sample_counts[0] = (uint32_t)pick_samples(keys, local_data_size_speedup_server,
+                                                               g_sample.samples[0], SAMPLES_PER_NODE);
+            if (!wait_until("wait_samples", [] { return g_sample.samples_received >= g_sample.nodes - 1; }))
+                break;
+
+            std::vector<float> all_samples;
+            std::vector<double> weights(g_sample.nodes);
+            for (int j = 0; j < g_sample.nodes; j++)
+            {
+                all_samples.insert(all_samples.end(), g_sample.samples[j], g_sample.samples[j] + g_sample.sample_counts[j]);
+                weights[j] = (double)((j == 0) ? local_data_size_speedup_server : g_workers[j - 1]->size);
+            }
+            SplittersPayload splitters;
+            splitters.count = g_sample.nodes - 1;
+            {
+                TRACE_SCOPE("choose_splitters", all_samples.size());
+                choose_splitters(all_samples.data(), all_samples.size(), weights.data(), g_sample.nodes,
+                                 splitters.splitters);
+            }
+            memcpy(g_sample.splitters, splitters.splitters, sizeof(splitters.splitters));
+            for (size_t i = 0; i < g_workers.size() && !g_aborted; i++)
+            {
+                send_message_to(g_workers[i]->addr, MSG_SPLITTERS, &splitters, sizeof(splitters));
+            }
+            if (g_aborted)
+                break;
+
+            server_sorted = sample_sort_local(round, keys, local_data_size_speedup_server, &server_sorted_count,
+                                              &server_compute_ms);
+            if (server_sorted == nullptr)
+                break;
+        }
+        else
         {
-            usleep(10000); // 10ms
+            // 键与成段已由流水线完成，只做剩下的排序
+            struct timespec sort_begin;
+            clock_gettime(CLOCK_MONOTONIC, &sort_begin);
+            sort_runs_finish(runs);
+            server_compute_ms += ms_since(sort_begin);
+            server_sorted = keys;
+            server_sorted_count = local_data_size_speedup_server;
         }
-        
+
+        struct timespec compute_end;
+        clock_gettime(CLOCK_MONOTONIC, &compute_end);
+        if (g_traceEnabled)
+            trace_record("server_compute", round_begin, trace_now(), round);
+        double server_ms = (compute_end.tv_sec - start.tv_sec) * 1000.0 + (compute_end.tv_nsec - start.tv_nsec) / 1e6;
+        printf("[Server] Server端已完成（%.2f ms，本地计算 %.2f ms），Sum结果: %f, Max结果: %f\n", server_ms,
+               server_compute_ms, server_sum, server_max);
+
+        size_t merged = 0;
+        bool ordered = true;
+        if (g_distSort == DIST_SORT_SAMPLE)
+        {
+            // 各节点的区间首尾相接且各自有序即全局有序，不需要再归并
+            printf("[Server] 等待%zu个Worker的排序区间...\n", g_workers.size());
+            g_sample.ranges[0] = summarize_range(server_sorted, server_sorted_count);
+            if (!wait_until("wait_ranges", [] { return g_sample.ranges_received >= g_sample.nodes - 1; }))
+                break;
+            bool has_last = false;
+            float last = 0.0f;
+            for (int j = 0; j < g_sample.nodes; j++)
+            {
+                const RangePayload& range = g_sample.ranges[j];
+                merged += range.count;
+                ordered = ordered && range.sorted;
+                if (range.count == 0)
+                    continue;
+                ordered = ordered && (!has_last || last <= range.first);
+                last = range.last;
+                has_last = true;
+            }
+            ordered = ordered && merged == total;
+        }
+        else
+        {
+            // 合并排序结果：Worker的数据块仍在到达时即开始流式多路归并
+            printf("[Server] 流式归并%zu个Worker的排序结果...\n", g_workers.size());
+            streams[0].data = server_sorted;
+            streams[0].total = local_data_size_speedup_server;
+            streams[0].avail = nullptr;
+            for (size_t i = 0; i < g_workers.size(); i++)
+            {
+                streams[i + 1].data = g_workers[i]->sorted;
+                streams[i + 1].total = g_workers[i]->size;
+                streams[i + 1].avail = &g_workers[i]->sorted_count;
+            }
+            float* final_sorted = arena_floats(ARENA_RESULT, total);
+            merged = mergeSortedStreams(streams.data(), (int)streams.size(), final_sorted);
+            for (size_t i = 0; i < g_workers.size(); i++)
+            {
+                transport_close_receive(sort_stream_id(round, g_workers[i]->id));
+            }
+            // 归并提前返回说明有Worker的数据没有到齐（发送失败、超时或测试已中止）
+            if (merged != total)
+            {
+                abort_test("汇总归并没有收齐各Worker的排序结果");
+                break;
+            }
+            TRACE_SCOPE("verify_sorted", merged);
+            ordered = std::is_sorted(final_sorted, final_sorted + merged);
+        }
+
+        // Wait for Worker results
+        printf("[Server] 等待Worker结果...\n");
+        for (size_t i = 0; i < g_workers.size() && !g_aborted; i++)
+        {
+            WorkerState* w = g_workers[i];
+            wait_until("wait_results", [w] { return w->results_ready.load(); });
+        }
+        if (g_aborted)
+            break;
+
         // Merge results
         printf("[Server] Merging results...\n");
-        float final_sum = server_sum + g_clientSum;
-        float final_max = (server_max > g_clientMax) ? server_max : g_clientMax;
-
-        // 合并排序结果
+        double final_sum = server_sum;
+        double final_max = server_max;
+        SumFixed final_fixed = server_fixed;
+        for (size_t i = 0; i < g_workers.size(); i++)
+        {
+            final_sum += g_workers[i]->sum;
+            final_fixed += g_workers[i]->sum_fixed;
+            final_max = std::max(final_max, g_workers[i]->max);
+        }
+        if (g_sumMode == SUM_EXACT)
+        {
+            final_sum = sum_fixed_to_double(final_fixed); // 整数求和，结果与节点数和划分无关
+        }
 
         clock_gettime(CLOCK_MONOTONIC, &end);
-        
-        printf("[Server] 最终加速的Sum结果: %f, Max结果: %f\n", final_sum, final_max);
-        printf("[Server] 排序合并完成\n");
-        
-        delete[] server_sorted;
-        
-        
+        if (g_traceEnabled)
+            trace_record("speedup_round", round_begin, trace_now(), round);
+
+        printf("[Server] 最终加速的Sum结果: %.17g, Max结果: %.17g\n", final_sum, final_max);
+        printf("[Server] 排序完成（%s），共 %zu 个元素，有序性校验: %s\n", dist_sort_name(g_distSort), merged,
+               ordered ? "通过" : "失败");
+
+        // 根据本轮各节点的本地计算用时修正吞吐量估计，下一轮重新划分
+        g_serverRate = update_rate(g_serverRate, local_data_size_speedup_server, server_compute_ms);
+        for (size_t i = 0; i < g_workers.size(); i++)
+        {
+            WorkerState* w = g_workers[i];
+            w->rate = update_rate(w->rate, w->size, w->compute_ms);
+        }
+
         double speedup_time = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+        printf("***本轮SpeedUp版总共用时: %.2f ms（含排序结果传输与归并；各阶段用时见 --trace）***\n", speedup_time);
+
+        // 只统计完整完成的轮次（中途失败的轮次在上面已经 break）
+        total_basic_time += basic_time;
         total_speedup_time += speedup_time;
-        printf("***本轮SpeedUp版总共用时: %.2f ms（未单独统计各部分时间）***\n", speedup_time);
+        if (round > warmup)
+        {
+            basic_sum_series.ms.push_back(basic_time_1);
+            basic_max_series.ms.push_back(basic_time_2);
+            basic_sort_series.ms.push_back(basic_time_3);
+            basic_round_series.ms.push_back(basic_time);
+            speedup_round_series.ms.push_back(speedup_time);
+        }
+        completed++;
+    }
+    if (g_aborted)
+    {
+        printf("\n[Server] 测试在第 %d 轮中止，统计只包含已完成的 %d 轮\n", completed + 1, completed);
+        abort_workers();
+    }
+
+    arena_print_stats();
+    arena_release_all();
+    input_release();
+    for (size_t i = 0; i < g_workers.size(); i++)
+    {
+        delete[] g_workers[i]->sorted;
+        delete g_workers[i];
     }
-    
+    g_workers.clear();
+
     printf("\n========================================\n");
     printf("测试完成！统计信息:\n");
     printf("========================================\n");
-    printf("Basic版本平均用时: %.2f ms\n", total_basic_time / g_run_times);
-    printf("SpeedUp版本平均用时: %.2f ms\n", total_speedup_time / g_run_times);
-    printf("加速比: %.2fx\n", total_basic_time / total_speedup_time);
+    if (completed > 0)
+    {
+        printf("Basic版本平均用时: %.2f ms\n", total_basic_time / completed);
+        printf("SpeedUp版本平均用时: %.2f ms\n", total_speedup_time / completed);
+        printf("加速比: %.2fx\n", total_basic_time / total_speedup_time);
+    }
+    else
+    {
+        printf("没有完成的轮次\n");
+    }
     printf("========================================\n");
-    
+
+    if (report != nullptr)
+    {
+        char nodes[16], threads[16];
+        snprintf(nodes, sizeof(nodes), "%d", g_expectedWorkers + 1);
+        snprintf(threads, sizeof(threads), "%d", omp_get_max_threads());
+        BenchContext context;
+        context.push_back(make_pair(string("mode"), string("server")));
+        context.push_back(make_pair(string("nodes"), string(nodes)));
+        context.push_back(make_pair(string("isa"), string(speedup_kernels().name)));
+        context.push_back(make_pair(string("threads"), string(threads)));
+        context.push_back(make_pair(string("sum_mode"), string(sum_mode_name(g_sumMode))));
+        context.push_back(make_pair(string("dist_sort"), string(dist_sort_name(g_distSort))));
+        vector<BenchSeries> series;
+        series.push_back(basic_sum_series);
+        series.push_back(basic_max_series);
+        series.push_back(basic_sort_series);
+        series.push_back(basic_round_series);
+        series.push_back(speedup_round_series);
+        bench_write_report(*report, context, series);
+    }
+
+    transport_print_stats();
+
+    // 通知接收线程退出并等它结束，再关闭套接字
+    transport_shutdown();
+    pthread_join(recv_thread, NULL);
+    trace_write("server");
     close(g_socket);
 }
 
-void run_client()
+// Worker：测试中止（数据交换或发送排序结果失败、等待超时）后向 Server 发送失败的 RESULTS_READY，
+// Server 随即中止测试并通知其他Worker，也不会再向已经退出的本节点发送 MSG_ABORT
+static void report_round_failure()
+{
+    if (g_serverGone)
+        return;
+    ReadyPayload ready;
+    ready.elapsed_ms = 0.0;
+    ready.compute_ms = 0.0;
+    ready.failed = 1;
+    ready.reserved = 0;
+    send_control_message(g_peerAddr, MSG_RESULTS_READY, &ready, sizeof(ready));
+}
+
+void run_client(int rounds)
 {
     g_isServer = false;
     g_socket = socket(AF_INET, SOCK_DGRAM, 0);
@@ -271,122 +1223,190 @@ void run_client()
         return;
     }
     printf("Socket Created.\n");
-    
+
+    // 绑定临时端口，同一台主机上可以运行多个Worker进程
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_port = 0;
+    local.sin_addr.s_addr = INADDR_ANY;
+    if (bind(g_socket, (struct sockaddr*)&local, sizeof(local)) < 0)
+    {
+        printf("bind failed with error: %s\n", strerror(errno));
+        close(g_socket);
+        return;
+    }
+
     g_peerAddr.sin_family = AF_INET;
-    g_peerAddr.sin_port = htons(SERVER_PORT);
-    g_peerAddr.sin_addr.s_addr = inet_addr(SERVER_IP);
+    g_peerAddr.sin_port = htons(g_serverPort);
+    if (inet_pton(AF_INET, g_serverIp, &g_peerAddr.sin_addr) != 1)
+    {
+        printf("无效的 Server 地址: %s\n", g_serverIp);
+        close(g_socket);
+        return;
+    }
     g_peerLen = sizeof(g_peerAddr);
+    transport_init(g_socket);
+
+    printf("Connecting to server %s:%d...\n", g_serverIp, g_serverPort);
 
-    printf("Connecting to server %s:%d...\n", SERVER_IP, SERVER_PORT);
-    
     // 创建接收线程
     pthread_t recv_thread;
     pthread_create(&recv_thread, NULL, receive_thread, NULL);
-    
-    // 让用户输入运行次数
-    int run_times;
-    printf("\n请输入测试的轮数（每轮包括basic版本和speedup版本）: ");
-    while(true)
-    {
-        cin >> run_times;
-        if(cin.good() && run_times > 0)
-        {
-            g_run_times = run_times;
-            break;
-        }
-        else
-        {
-            printf("Please enter a valid positive integer: ");
-            cin.clear();
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        }
-    }
-    
-    // 发送运行次数信号给 Server
-    char times_msg[32];
-    sprintf(times_msg, "RUN_TIMES:%d", g_run_times);
-    sendto(g_socket, times_msg, strlen(times_msg), 0, 
-          (struct sockaddr*)&g_peerAddr, g_peerLen);
-    printf("[Client] Sent run_times: %d\n", g_run_times);
-    
-    // Wait a moment for Server to receive
-    usleep(100000);
-    
+
+    // 测试轮数：命令行未指定时让用户输入
+    g_run_times = (rounds > 0) ? rounds
+                               : prompt_positive("\n请输入测试的轮数（每轮包括basic版本和speedup版本）: ", INT_MAX);
+
+    // 标定本机吞吐量，加入集群时连同请求的测试轮数一起报告
+    NodeThroughput throughput = calibrate_throughput(std::min<size_t>(CALIBRATION_SAMPLE, DATANUM));
+    JoinPayload join;
+    join.run_times = g_run_times;
+    join.reserved = 0;
+    join.sum_rate = throughput.sum_rate;
+    join.max_rate = throughput.max_rate;
+    join.sort_rate = throughput.sort_rate;
+    if (send_message(MSG_JOIN, &join, sizeof(join)))
+        printf("[Client] Joined, requested run_times: %d\n", g_run_times.load());
+
     printf("\n========================================\n");
-    printf("Ready! 开始 %d 轮测试\n", g_run_times);
+    printf("Ready! 开始 %d 轮测试\n", g_run_times.load());
     printf("========================================\n\n");
-    
+
     // Loop for specified number of rounds, each round runs basic + speedup
-    for (int round = 1; round <= g_run_times; round++)
+    // 任何一步失败都会置位 g_aborted，结束测试
+    for (int round = 1; round <= g_run_times && !g_aborted; round++)
     {
-        printf("\n========== Round %d/%d ==========\n", round, g_run_times);
-        
+        printf("\n========== Round %d/%d ==========\n", round, g_run_times.load());
+        g_round.store(round, std::memory_order_release);
+
         // ===== 1. BASIC VERSION =====
-        // Client doesn't participate, wait for Server to complete
+        // Client doesn't participate, wait for Server to complete and send this round's assignment
+        // 第一轮的分配要等所有Worker加入后才下发，不设超时
         printf("\n[Basic Version - Client waiting for Server...]\n");
-        
-        // Wait for Server to send BASIC_DONE signal
-        while (!g_peerBasicDone)
+        if (!wait_for("wait_assign", (round == 1) ? 0 : transport_config().wait_timeout_ms,
+                      [round] { return g_assignRound == round; }))
+            break;
+        AssignPayload assign = g_assign;
+        printf("[Client] Received assignment, ready for speedup version...\n");
+
+        // ===== 2. SPEEDUP VERSION =====
+        printf("\n[SpeedUp版本 - Worker %d 处理全局下标 [%llu, %llu)]\n", assign.worker_id,
+               (unsigned long long)assign.start, (unsigned long long)(assign.start + assign.size));
+        const size_t local_size = assign.size;
+        const bool sample_sort = (assign.dist_sort == DIST_SORT_SAMPLE);
+        if (sample_sort)
         {
-            usleep(10000); // 10ms
+            if (!wait_until("wait_peers", [] { return g_sample.peers_ready != 0; }))
+                break;
+            g_sample.self.store(assign.worker_id + 1, std::memory_order_release);
+            sample_sort_reset();
         }
-        printf("[Client] Received Server basic version done signal\n");
-        
-        // Send confirmation signal
-        const char* confirm_msg = "BASIC_DONE";
-        sendto(g_socket, confirm_msg, strlen(confirm_msg), 0, 
-              (struct sockaddr*)&g_peerAddr, g_peerLen);
-        printf("[Client] Confirmed, ready for speedup version...\n");
-        
-        // Reset flag
-        g_peerBasicDone = false;
-        
-        // ===== 2. SPEEDUP VERSION =====
-        printf("\n[SpeedUp版本 - Client处理后半部分]\n");
-
-        // 数据初始化：Client生成自己的数据（从逻辑上对应服务器的后半部分数据）
-        data_init_and_shuffle(local_data_size_speedup_server, local_data_size_speedup_client);
-
-        // Wait for Server ready signal
-        usleep(100000);
-        
-        // Process data (Client处理自己生成的数据，从数组开头开始)
-        float client_sum = sumSpeedUp(rawFloatData, local_data_size_speedup_client);
-        float client_max = maxSpeedUp(rawFloatData, local_data_size_speedup_client);
-        float* client_sorted = new float[local_data_size_speedup_client];
-        sortSpeedUp(rawFloatData, local_data_size_speedup_client, client_sorted);
-        
-        printf("[Client] Sum: %f, Max: %f\n", client_sum, client_max);
-        
-        // Send results to Server
-        printf("[Client] Sending results to Server...\n");
-        char result_msg[64];
-        
-        sprintf(result_msg, "RESULT_SUM:%f", client_sum);
-        sendto(g_socket, result_msg, strlen(result_msg), 0, 
-              (struct sockaddr*)&g_peerAddr, g_peerLen);
-        usleep(1000);
-        
-        sprintf(result_msg, "RESULT_MAX:%f", client_max);
-        sendto(g_socket, result_msg, strlen(result_msg), 0, 
-              (struct sockaddr*)&g_peerAddr, g_peerLen);
-        usleep(1000);
-        
-        // Signal that all results are ready
-        const char* ready_msg = "RESULTS_READY";
-        sendto(g_socket, ready_msg, strlen(ready_msg), 0, 
-              (struct sockaddr*)&g_peerAddr, g_peerLen);
-        
-        delete[] client_sorted;
-        
+
+        // Worker只生成（或从输入文件读入）全局数据中自己那一段下标，
+        // 逐块加载的同时完成求和、最大值与排序键计算（汇总归并时还有排序的成段阶段）
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        const uint64_t round_begin = trace_now();
+        float* keys = arena_floats(ARENA_KEYS, local_size);
+        SortRuns runs;
+        if (!sample_sort)
+        {
+            runs = sort_runs_prepare(sort_backend(), keys, local_size, arena_floats(ARENA_SCRATCH_B, local_size));
+        }
+        LocalResult local;
+        if (!run_local_pipeline(assign.start, local_size, assign.sum_mode, keys, sample_sort ? nullptr : &runs, &local))
+        {
+            // 循环结束后向 Server 报告失败，Server 中止本轮并通知其他Worker
+            abort_test("Worker 无法加载本节点的数据");
+            break;
+        }
+        double compute_ms = ms_since(start); // 本地计算用时：流水线与本地排序，不含等待与传输
+        float client_max = local.max;
+        SumPayload sum_result;
+        sum_result.sum = (assign.sum_mode == SUM_EXACT) ? sum_fixed_to_double(local.fixed) : local.sum;
+        sum_result.fixed = local.fixed;
+        printf("[Client] Sum: %f, Max: %f\n", sum_result.sum, client_max);
+
+        if (sample_sort)
+        {
+            // 上报样本，Sum/Max 照常发给Server，然后等待分割点
+            SamplesPayload samples;
+            memset(&samples, 0, sizeof(samples));
+            samples.node = g_sample.self;
+            samples.count = (uint32_t)pick_samples(keys, local_size, samples.samples, SAMPLES_PER_NODE);
+            printf("[Client] Sending results to Server...\n");
+            if (!send_message(MSG_SAMPLES, &samples, sizeof(samples)) ||
+                !send_message(MSG_RESULT_SUM, &sum_result, sizeof(sum_result)) ||
+                !send_value(MSG_RESULT_MAX, client_max))
+                break;
+
+            if (!wait_until("wait_splitters", [round] { return g_sample.splitters_round == round; }))
+                break;
+
+            // 与所有节点交换数据，排序本节点负责的键区间，向Server报告区间首尾
+            size_t range_count;
+            float* range = sample_sort_local(round, keys, local_size, &range_count, &compute_ms);
+            if (range == nullptr)
+                break;
+            RangePayload summary = summarize_range(range, range_count);
+            printf("[Client] 样本排序完成，本节点区间 %zu 个键 [%f, %f]\n", range_count, summary.first, summary.last);
+            if (!send_message(MSG_RANGE_SUMMARY, &summary, sizeof(summary)))
+                break;
+        }
+        else
+        {
+            struct timespec sort_begin;
+            clock_gettime(CLOCK_MONOTONIC, &sort_begin);
+            sort_runs_finish(runs);
+            compute_ms += ms_since(sort_begin);
+            float* client_sorted = keys;
+
+            // Send results to Server
+            printf("[Client] Sending results to Server...\n");
+            if (!send_message(MSG_RESULT_SUM, &sum_result, sizeof(sum_result)) || !send_value(MSG_RESULT_MAX, client_max))
+                break;
+
+            // 分块发送排序结果，Server边接收边归并
+            printf("[Client] Streaming sorted data (%zu floats) to Server...\n", local_size);
+            if (!transport_send_bulk(g_peerAddr, assign.stream, client_sorted, local_size * sizeof(float)))
+            {
+                abort_test("向 Server 发送排序结果超时");
+                break;
+            }
+        }
+
+        // Signal that all results are ready，附带本轮用时与本地计算用时，后者供Server修正划分
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (g_traceEnabled)
+            trace_record("speedup_round", round_begin, trace_now(), round);
+        double elapsed_ms = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+        ReadyPayload ready;
+        ready.elapsed_ms = elapsed_ms;
+        ready.compute_ms = compute_ms;
+        ready.failed = 0;
+        ready.reserved = 0;
+        if (!send_message(MSG_RESULTS_READY, &ready, sizeof(ready)))
+            break;
+
         printf("[Client] Results sent\n");
     }
-    
+    if (g_aborted)
+    {
+        report_round_failure();
+    }
+
     printf("\n========================================\n");
-    printf("[Client] 测试完成！\n");
+    printf("[Client] %s\n", g_aborted ? "测试中止" : "测试完成！");
     printf("========================================\n");
-    
-    close(g_socket);
-}
 
+    arena_print_stats();
+    arena_release_all();
+    input_release();
 
+    transport_print_stats();
+    transport_shutdown();
+    pthread_join(recv_thread, NULL);
+    trace_write("worker");
+    close(g_socket);
+}
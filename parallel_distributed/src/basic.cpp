@@ -8,8 +8,21 @@
 #include <cmath>
 #include <limits>
 
+// 比较两个原始元素变换后的大小：单调变换直接比较原始数据，比较处不再调用变换
+// （Transform::monotonic 是编译期常量，另一个分支被编译器删除）
+template <typename Transform>
+static inline bool transformed_less_equal(float a, float b)
+{
+    if (Transform::monotonic)
+    {
+        return a <= b;
+    }
+    return Transform::reference(a) <= Transform::reference(b);
+}
+
 // 未加速的求和函数
-float sumBasic(const float data[], const int len)
+template <typename Transform>
+float sumBasicWith(const float data[], const int len)
 {
     const int UNROLL = 4096;
     float sums[UNROLL] = {0};  // 数组初始化为0
@@ -19,7 +32,7 @@ float sumBasic(const float data[], const int len)
     {
         for(int j = 0; j < UNROLL && (i + j) < len; j++)
         {
-            sums[j] += std::log(std::sqrt(data[i + j]));
+            sums[j] += Transform::reference(data[i + j]);
         }
     }
     
@@ -34,12 +47,13 @@ float sumBasic(const float data[], const int len)
 }
 
 // 未加速的最大值函数
-float maxBasic(const float data[], const int len)
+template <typename Transform>
+float maxBasicWith(const float data[], const int len)
 {
     float max_value = -std::numeric_limits<float>::infinity(); // 初始化为最小值
     for (int i = 0; i < len; i++)
     {
-        float value = std::log(std::sqrt(data[i]));
+        float value = Transform::reference(data[i]);
         if (value > max_value)
         {
             max_value = value;
@@ -49,16 +63,17 @@ float maxBasic(const float data[], const int len)
 }
 
 // 归并排序的合并函数
-void merge(const float data[], size_t* indices, size_t left, size_t mid, size_t right, size_t* temp)
+template <typename Transform, typename Index>
+void merge(const float data[], Index* indices, Index left, Index mid, Index right, Index* temp)
 {
-    size_t i = left; // 左子数组起始索引
-    size_t j = mid + 1; // 右子数组起始索引
-    size_t k = left;    // 临时数组起始索引
+    Index i = left; // 左子数组起始索引
+    Index j = mid + 1; // 右子数组起始索引
+    Index k = left;    // 临时数组起始索引
     
     // 合并两个子数组
     while (i <= mid && j <= right)
     {
-        if (std::log(std::sqrt(data[indices[i]])) <= std::log(std::sqrt(data[indices[j]])))
+        if (transformed_less_equal<Transform>(data[indices[i]], data[indices[j]]))
         {
             temp[k++] = indices[i++];
         }
@@ -79,47 +94,83 @@ void merge(const float data[], size_t* indices, size_t left, size_t mid, size_t
     }
     
     // 将排序结果复制回原数组
-    for (size_t idx = left; idx <= right; idx++)
+    for (Index idx = left; idx <= right; idx++)
     {
         indices[idx] = temp[idx];
     }
 }
 
 // 归并排序递归函数
-void mergeSort(const float data[], size_t* indices, size_t left, size_t right, size_t* temp)
+template <typename Transform, typename Index>
+void mergeSort(const float data[], Index* indices, Index left, Index right, Index* temp)
 {
     if (left < right)
     {
-        size_t mid = left + (right - left) / 2; 
-        mergeSort(data, indices, left, mid, temp); // 排序左半部分
-        mergeSort(data, indices, mid + 1, right, temp); // 排序右半部分
-        merge(data, indices, left, mid, right, temp); // 合并两部分
+        Index mid = left + (right - left) / 2; 
+        mergeSort<Transform>(data, indices, left, mid, temp); // 排序左半部分
+        mergeSort<Transform>(data, indices, mid + 1, right, temp); // 排序右半部分
+        merge<Transform>(data, indices, left, mid, right, temp); // 合并两部分
     }
 }
 
-// 未加速的排序函数
-void sortBasic(const float data[], const int len, float* result)
+// 按下标宽度 Index 进行索引归并排序
+template <typename Transform, typename Index>
+static void sortBasicIndexed(const float data[], const int len, float* result)
 {
-    // 创建索引数组
-    size_t* sortIndices = new size_t[len];
+    // 创建索引数组（缓冲区池中跨轮复用）
+    Index* sortIndices = (Index*)arena_get(ARENA_SCRATCH_A, (size_t)len * sizeof(Index));
     for (int i = 0; i < len; i++)
     {
-        sortIndices[i] = i;
+        sortIndices[i] = (Index)i;
     }
     
     // 创建临时数组用于归并排序
-    size_t* tempIndices = new size_t[len];
+    Index* tempIndices = (Index*)arena_get(ARENA_SCRATCH_B, (size_t)len * sizeof(Index));
     
     // 进行归并排序
-    mergeSort(data, sortIndices, 0, len - 1, tempIndices);
+    mergeSort<Transform, Index>(data, sortIndices, 0, (Index)(len - 1), tempIndices);
     
     // 根据排序后的索引填充结果数组
     for (int i = 0; i < len; i++)
     {
-        result[i] = std::log(std::sqrt(data[sortIndices[i]]));
+        result[i] = Transform::reference(data[sortIndices[i]]);
     }
-    
-    // 释放内存
-    delete[] tempIndices;
-    delete[] sortIndices;
-}
\ No newline at end of file
+}
+
+// 未加速的排序函数：len 为 int，元素个数总在 32 位以内，用 uint32_t 下标
+template <typename Transform>
+void sortBasicWith(const float data[], const int len, float* result)
+{
+    if (len <= 0)
+    {
+        return;
+    }
+    sortBasicIndexed<Transform, uint32_t>(data, len, result);
+}
+
+// 项目的计算任务 log(sqrt(x))
+float sumBasic(const float data[], const int len)
+{
+    return sumBasicWith<LogSqrtTransform>(data, len);
+}
+
+float maxBasic(const float data[], const int len)
+{
+    return maxBasicWith<LogSqrtTransform>(data, len);
+}
+
+void sortBasic(const float data[], const int len, float* result)
+{
+    sortBasicWith<LogSqrtTransform>(data, len, result);
+}
+
+// 显式实例化：transforms.hpp 中的每种变换，归并辅助函数使用 32 位下标
+#define INSTANTIATE_BASIC(T)                                                                          \
+    template float sumBasicWith<T>(const float[], const int);                                         \
+    template float maxBasicWith<T>(const float[], const int);                                         \
+    template void sortBasicWith<T>(const float[], const int, float*);                                 \
+    template void merge<T, uint32_t>(const float[], uint32_t*, uint32_t, uint32_t, uint32_t, uint32_t*); \
+    template void mergeSort<T, uint32_t>(const float[], uint32_t*, uint32_t, uint32_t, uint32_t*);
+INSTANTIATE_BASIC(LogSqrtTransform)
+INSTANTIATE_BASIC(SqrtTransform)
+INSTANTIATE_BASIC(SquareTransform)
@@ -0,0 +1,361 @@
+/*
+    基准测试驱动（--mode bench）与结果报告（单机基准和 Server 的逐轮统计共用）
+    每项操作先预热 warmup 次（缺页、缓冲区池映射、分支预测与缓存都进入稳定状态），
+    再测量 reps 次，报告最短/中位数/p95/平均用时，吞吐量按中位数计算
+*/
+
+#include "bench.hpp"
+#include "common.hpp"
+#include "input.hpp"
+#include "kernels.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <time.h>
+#include <omp.h>
+
+int bench_format_from_name(const char* name)
+{
+    if (strcmp(name, "table") == 0)
+        return BENCH_TABLE;
+    if (strcmp(name, "csv") == 0)
+        return BENCH_CSV;
+    if (strcmp(name, "json") == 0)
+        return BENCH_JSON;
+    return -1;
+}
+
+const char* bench_format_name(int format)
+{
+    switch (format)
+    {
+        case BENCH_CSV:  return "csv";
+        case BENCH_JSON: return "json";
+        default:         return "table";
+    }
+}
+
+BenchStats bench_stats(const std::vector<double>& ms)
+{
+    BenchStats st = {0.0, 0.0, 0.0, 0.0};
+    if (ms.empty())
+        return st;
+
+    std::vector<double> sorted(ms);
+    std::sort(sorted.begin(), sorted.end());
+    const size_t n = sorted.size();
+    st.min_ms = sorted[0];
+    st.median_ms = (n % 2 == 1) ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+    st.p95_ms = sorted[(size_t)std::ceil(0.95 * n) - 1];
+    double total = 0.0;
+    for (size_t i = 0; i < n; i++)
+        total += sorted[i];
+    st.mean_ms = total / n;
+    return st;
+}
+
+// 每秒百万元素，按中位数用时计算
+static double melems_per_s(const BenchSeries& s, const BenchStats& st)
+{
+    return (st.median_ms > 0.0) ? s.elements / (st.median_ms * 1e3) : 0.0;
+}
+
+// 每秒读入的输入数据量（MB），元素都是 float
+static double mbytes_per_s(const BenchSeries& s, const BenchStats& st)
+{
+    return melems_per_s(s, st) * sizeof(float);
+}
+
+static void write_table(FILE* f, const BenchContext& context, const std::vector<BenchSeries>& series)
+{
+    int width = 14;     // 微基准的名称较长（sumSpeedUp/65536/threads:4），按最长的名称对齐
+    for (size_t i = 0; i < series.size(); i++)
+        width = std::max(width, (int)series[i].name.size());
+
+    fprintf(f, "\n[Bench]");
+    for (size_t i = 0; i < context.size(); i++)
+        fprintf(f, " %s=%s", context[i].first.c_str(), context[i].second.c_str());
+    fprintf(f, "\n%-*s %12s %6s %10s %10s %10s %10s %12s %10s\n", width, "operation", "elements", "reps", "min(ms)",
+            "median(ms)", "p95(ms)", "mean(ms)", "Melem/s", "MB/s");
+    for (size_t i = 0; i < series.size(); i++)
+    {
+        const BenchSeries& s = series[i];
+        const BenchStats st = bench_stats(s.ms);
+        fprintf(f, "%-*s %12zu %6zu %10.3f %10.3f %10.3f %10.3f %12.1f %10.1f\n", width, s.name.c_str(), s.elements,
+                s.ms.size(), st.min_ms, st.median_ms, st.p95_ms, st.mean_ms, melems_per_s(s, st), mbytes_per_s(s, st));
+    }
+}
+
+// 每行都带上环境列，多次运行的结果可以直接拼接后按列筛选
+static void write_csv(FILE* f, const BenchContext& context, const std::vector<BenchSeries>& series)
+{
+    for (size_t i = 0; i < context.size(); i++)
+        fprintf(f, "%s,", context[i].first.c_str());
+    fprintf(f, "operation,elements,reps,min_ms,median_ms,p95_ms,mean_ms,melem_per_s,mb_per_s\n");
+    for (size_t i = 0; i < series.size(); i++)
+    {
+        const BenchSeries& s = series[i];
+        const BenchStats st = bench_stats(s.ms);
+        for (size_t c = 0; c < context.size(); c++)
+            fprintf(f, "%s,", context[c].second.c_str());
+        fprintf(f, "%s,%zu,%zu,%.6f,%.6f,%.6f,%.6f,%.3f,%.3f\n", s.name.c_str(), s.elements, s.ms.size(), st.min_ms,
+                st.median_ms, st.p95_ms, st.mean_ms, melems_per_s(s, st), mbytes_per_s(s, st));
+    }
+}
+
+// 名称与环境值都由本程序生成（操作名、数字、指令集名等），不含需要转义的字符
+static void write_json(FILE* f, const BenchContext& context, const std::vector<BenchSeries>& series)
+{
+    fprintf(f, "{\n  \"context\": {");
+    for (size_t i = 0; i < context.size(); i++)
+        fprintf(f, "%s\"%s\": \"%s\"", i ? ", " : "", context[i].first.c_str(), context[i].second.c_str());
+    fprintf(f, "},\n  \"results\": [");
+    for (size_t i = 0; i < series.size(); i++)
+    {
+        const BenchSeries& s = series[i];
+        const BenchStats st = bench_stats(s.ms);
+        fprintf(f, "%s\n    {\"operation\": \"%s\", \"elements\": %zu, \"reps\": %zu, \"min_ms\": %.6f, "
+                "\"median_ms\": %.6f, \"p95_ms\": %.6f, \"mean_ms\": %.6f, \"melem_per_s\": %.3f, \"mb_per_s\": %.3f, "
+                "\"samples_ms\": [",
+                i ? "," : "", s.name.c_str(), s.elements, s.ms.size(), st.min_ms, st.median_ms, st.p95_ms, st.mean_ms,
+                melems_per_s(s, st), mbytes_per_s(s, st));
+        for (size_t k = 0; k < s.ms.size(); k++)
+            fprintf(f, "%s%.6f", k ? ", " : "", s.ms[k]);
+        fprintf(f, "]}");
+    }
+    fprintf(f, "\n  ]\n}\n");
+}
+
+bool bench_write_report(const BenchOutput& out, const BenchContext& context, const std::vector<BenchSeries>& series)
+{
+    FILE* f = stdout;
+    if (out.path != nullptr)
+    {
+        f = fopen(out.path, "w");
+        if (f == nullptr)
+        {
+            printf("[Bench] 无法写入 %s: %s\n", out.path, strerror(errno));
+            return false;
+        }
+    }
+
+    if (out.format == BENCH_CSV)
+        write_csv(f, context, series);
+    else if (out.format == BENCH_JSON)
+        write_json(f, context, series);
+    else
+        write_table(f, context, series);
+
+    if (f != stdout)
+    {
+        fclose(f);
+        printf("[Bench] 结果已写入 %s（%s）\n", out.path, bench_format_name(out.format));
+    }
+    else
+    {
+        fflush(f);
+    }
+    return true;
+}
+
+// ===== 单机基准 =====
+
+static volatile float g_benchSink;  // 保留 Sum/Max 的结果，避免被优化掉
+static int g_benchTransform = TRANSFORM_LOG_SQRT;  // 各操作作用的变换（PARDIST_TRANSFORM）
+
+// 基础版本按变换分发到 basic.cpp 中的模板实例
+static void op_basic_sum(const float data[], int n)
+{
+    switch (g_benchTransform)
+    {
+        case TRANSFORM_SQRT:   g_benchSink = sumBasicWith<SqrtTransform>(data, n); break;
+        case TRANSFORM_SQUARE: g_benchSink = sumBasicWith<SquareTransform>(data, n); break;
+        default:               g_benchSink = sumBasic(data, n); break;
+    }
+}
+
+static void op_basic_max(const float data[], int n)
+{
+    switch (g_benchTransform)
+    {
+        case TRANSFORM_SQRT:   g_benchSink = maxBasicWith<SqrtTransform>(data, n); break;
+        case TRANSFORM_SQUARE: g_benchSink = maxBasicWith<SquareTransform>(data, n); break;
+        default:               g_benchSink = maxBasic(data, n); break;
+    }
+}
+
+static void op_basic_sort(const float data[], int n)
+{
+    float* result = arena_floats(ARENA_RESULT, n);
+    switch (g_benchTransform)
+    {
+        case TRANSFORM_SQRT:   sortBasicWith<SqrtTransform>(data, n, result); break;
+        case TRANSFORM_SQUARE: sortBasicWith<SquareTransform>(data, n, result); break;
+        default:               sortBasic(data, n, result); break;
+    }
+}
+
+// 加速版本直接取内核表中该变换的实例（log_sqrt 的实例即 sumSpeedUp 等使用的内核）
+static void op_sum(const float data[], int n) { g_benchSink = speedup_kernels().transforms[g_benchTransform].sum(data, n); }
+static void op_max(const float data[], int n) { g_benchSink = speedup_kernels().transforms[g_benchTransform].max(data, n); }
+
+static void op_sum_max(const float data[], int n)
+{
+    float sum, max;
+    sumMaxTransformed(g_benchTransform, data, n, &sum, &max);
+    g_benchSink = sum + max;
+}
+
+static void op_sum_exact(const float data[], int n)
+{
+    SumFixed sum;
+    float max;
+    sumMaxExactSpeedUp(data, n, &sum, &max);
+    g_benchSink = (float)sum_fixed_to_double(sum) + max;
+}
+
+static void op_sort(const float data[], int n) { sortTransformed(g_benchTransform, data, n, arena_floats(ARENA_RESULT, n)); }
+
+static void op_argsort(const float data[], int n)
+{
+    argsortSpeedUp(data, n, (KeyIndex*)arena_get(ARENA_KEYS, (size_t)n * sizeof(KeyIndex)));
+}
+
+struct BenchOp
+{
+    const char* name;
+    void (*run)(const float data[], int n);
+    bool log_sqrt_only;     // 定点求和与 argsort 只有 log(sqrt(x)) 的实现
+};
+
+// all 按这个顺序运行
+static const BenchOp g_benchOps[] = {
+    {"basic_sum", op_basic_sum, false},
+    {"basic_max", op_basic_max, false},
+    {"basic_sort", op_basic_sort, false},
+    {"sum", op_sum, false},
+    {"max", op_max, false},
+    {"sum_max", op_sum_max, false},
+    {"sum_exact", op_sum_exact, true},
+    {"sort", op_sort, false},
+    {"argsort", op_argsort, true},
+};
+static const int g_benchOpCount = sizeof(g_benchOps) / sizeof(g_benchOps[0]);
+
+// 解析逗号分隔的操作列表，未知的名称或当前变换不支持的操作返回 false；all 跳过当前变换不支持的操作
+static bool parse_ops(const char* list, std::vector<const BenchOp*>& ops)
+{
+    const bool log_sqrt = (g_benchTransform == TRANSFORM_LOG_SQRT);
+    if (strcmp(list, "all") == 0)
+    {
+        for (int i = 0; i < g_benchOpCount; i++)
+        {
+            if (log_sqrt || !g_benchOps[i].log_sqrt_only)
+                ops.push_back(&g_benchOps[i]);
+        }
+        return true;
+    }
+
+    std::string names(list);
+    size_t begin = 0;
+    while (begin <= names.size())
+    {
+        size_t end = names.find(',', begin);
+        if (end == std::string::npos)
+            end = names.size();
+        const std::string name = names.substr(begin, end - begin);
+        const BenchOp* op = nullptr;
+        for (int i = 0; i < g_benchOpCount; i++)
+        {
+            if (name == g_benchOps[i].name)
+                op = &g_benchOps[i];
+        }
+        if (op == nullptr)
+        {
+            printf("[Bench] 未知的操作 \"%s\"，可选:", name.c_str());
+            for (int i = 0; i < g_benchOpCount; i++)
+                printf(" %s", g_benchOps[i].name);
+            printf(" all\n");
+            return false;
+        }
+        if (op->log_sqrt_only && !log_sqrt)
+        {
+            printf("[Bench] 操作 %s 只支持 log_sqrt 变换，当前为 %s\n", op->name, transform_name(g_benchTransform));
+            return false;
+        }
+        ops.push_back(op);
+        begin = end + 1;
+    }
+    return !ops.empty();
+}
+
+int run_bench(const BenchOptions& options)
+{
+    g_benchTransform = transform_from_env();
+    std::vector<const BenchOp*> ops;
+    if (!parse_ops(options.ops, ops))
+        return 1;
+
+    const size_t total = input_total();
+    const size_t size = (options.size == 0) ? total : options.size;
+    if (size == 0 || size > total || size > (size_t)INT_MAX)
+    {
+        printf("[Bench] 元素个数 %zu 无效（输入共 %zu 个，且不能超过 %d）\n", size, total, INT_MAX);
+        return 1;
+    }
+
+    const float* data = load_partition(0, size);
+    if (data == nullptr)
+        return 1;
+    const int n = (int)size;
+
+    printf("[Bench] %zu 个元素（%s），变换 %s，%d 线程，预热 %d 次，测量 %d 次\n", size, input_kind_name(input_kind()),
+           transform_name(g_benchTransform), omp_get_max_threads(), options.warmup, options.reps);
+
+    std::vector<BenchSeries> series;
+    for (size_t i = 0; i < ops.size(); i++)
+    {
+        const BenchOp* op = ops[i];
+        for (int r = 0; r < options.warmup; r++)
+            op->run(data, n);
+
+        BenchSeries s;
+        s.name = op->name;
+        s.elements = size;
+        for (int r = 0; r < options.reps; r++)
+        {
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            {
+                TRACE_SCOPE(op->name, r);
+                op->run(data, n);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            s.ms.push_back((end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6);
+        }
+        const BenchStats st = bench_stats(s.ms);
+        printf("[Bench] %-10s 中位数 %.3f ms，p95 %.3f ms\n", op->name, st.median_ms, st.p95_ms);
+        series.push_back(s);
+    }
+
+    char threads[16];
+    snprintf(threads, sizeof(threads), "%d", omp_get_max_threads());
+    BenchContext context;
+    context.push_back(std::make_pair(std::string("mode"), std::string("bench")));
+    context.push_back(std::make_pair(std::string("isa"), std::string(speedup_kernels().name)));
+    context.push_back(std::make_pair(std::string("threads"), std::string(threads)));
+    context.push_back(std::make_pair(std::string("sort"), std::string(sort_backend_name(sort_backend()))));
+    context.push_back(std::make_pair(std::string("transform"), std::string(transform_name(g_benchTransform))));
+    context.push_back(std::make_pair(std::string("input"), std::string(input_kind_name(input_kind()))));
+
+    const bool ok = bench_write_report(options.output, context, series);
+    trace_write("bench");
+    arena_release_all();
+    input_release();
+    return ok ? 0 : 1;
+}
@@ -4,30 +4,149 @@
 
 #include <iostream>
 #include <random>
+#include <algorithm>
+#include <stdint.h>
 #include "common.hpp"
+#include "input.hpp"
 
-float rawFloatData[DATANUM];
+float* rawFloatData = nullptr;
 
-// 数据初始化，值域 [start + 1, start + local_data_size]
+// 计数器式随机数（splitmix64 的混合函数）：结果只取决于输入，各线程不需要共享生成器状态
+static inline uint64_t mix64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// [0, bound) 内的随机数（乘法取高位，偏差可以忽略）
+static inline size_t random_below(uint64_t key, uint64_t counter, size_t bound)
+{
+    return (size_t)(((unsigned __int128)mix64(key + counter) * bound) >> 64);
+}
+
+// Feistel 网络在 [0, 2^bits) 上是一个置换（左右两半位数可以不同，每轮交换），
+// bits 取不小于 log2(DATANUM) 的最小值，结果不小于 DATANUM 时再加密一次（cycle walking），
+// 即得到 [0, DATANUM) 上的置换，平均每个元素加密不到 2 次
+#define FEISTEL_ROUNDS 4
+#define FEISTEL_SEED 0x5044u        // 固定密钥：所有节点生成同一个全局排列
+
+struct FeistelPermutation
+{
+    int left_bits;
+    int right_bits;
+    uint64_t keys[FEISTEL_ROUNDS];
+};
+
+static FeistelPermutation make_permutation()
+{
+    int bits = 2;
+    while ((1ull << bits) < (uint64_t)DATANUM)
+    {
+        bits++;
+    }
+    FeistelPermutation p;
+    p.left_bits = bits / 2;
+    p.right_bits = bits - p.left_bits;
+    for (int r = 0; r < FEISTEL_ROUNDS; r++)
+    {
+        p.keys[r] = mix64(FEISTEL_SEED + r);
+    }
+    return p;
+}
+
+static const FeistelPermutation& global_permutation()
+{
+    static const FeistelPermutation permutation = make_permutation();
+    return permutation;
+}
+
+// 轮函数只用一次乘法：(right ^ key) 乘以奇数常量后取高 out_bits 位，高位混合了所有输入位
+static inline uint64_t feistel_round(uint64_t right, uint64_t key, int out_bits)
+{
+    return ((right ^ key) * 0x9E3779B97F4A7C15ull) >> (64 - out_bits);
+}
+
+static inline uint64_t permute_index(const FeistelPermutation& p, uint64_t x)
+{
+    do
+    {
+        int left_bits = p.left_bits;
+        int right_bits = p.right_bits;
+        uint64_t left = x >> right_bits;
+        uint64_t right = x & ((1ull << right_bits) - 1);
+        for (int r = 0; r < FEISTEL_ROUNDS; r++)
+        {
+            uint64_t next = left ^ feistel_round(right, p.keys[r], left_bits);
+            left = right;
+            right = next;
+            std::swap(left_bits, right_bits);
+        }
+        x = (left << right_bits) | right;
+    } while (x >= (uint64_t)DATANUM);
+    return x;
+}
+
+// 数据初始化：全局下标 [start, start + local_data_size) 上的值，
+// 整个 [0, DATANUM) 恰好是 1..DATANUM 的一个伪随机排列，每个元素可以独立算出
+// 与加速版内核相同的 static 划分并行写入：页面由之后处理它的线程首次触及，分配在该线程所在的 NUMA 节点
 void init_rawData(int start, size_t local_data_size)
 {
-    for (size_t i = 0; i < local_data_size; ++i) {
-        rawFloatData[i] = static_cast<float>(start + i + 1);
+    static const FeistelPermutation& permutation = global_permutation();
+    float* data = input_synthetic_buffer(local_data_size);
+    const long long n = (long long)local_data_size;
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < n; ++i)
+    {
+        data[i] = static_cast<float>(permute_index(permutation, (uint64_t)start + i) + 1);
     }
 }
 
-// 使用Fisher-Yates算法打乱数组
-void shuffle_rawData(size_t local_data_size)
+// 块内 Fisher-Yates，key 决定这一块的随机序列
+static void shuffle_block(float block[], size_t size, uint64_t key)
+{
+    for (size_t i = size - 1; i > 0 && size > 1; --i)
+    {
+        size_t j = random_below(key, i, i + 1);
+        std::swap(block[i], block[j]);
+    }
+}
+
+uint64_t new_shuffle_seed()
 {
     std::random_device rd;
-    std::mt19937 g(rd());
-    
-    for (size_t i = local_data_size - 1; i > 0; --i)
+    return ((uint64_t)rd() << 32) | rd();
+}
+
+// 分块洗牌：全局排列本身已经打乱，每轮只在 SHUFFLE_BLOCK 大小的块内重新 Fisher-Yates，
+// 块在缓存内、各块互不相关，可以并行；随机数由（本次种子, 块号, 计数）决定，与线程数无关
+void shuffle_rawData(size_t local_data_size)
+{
+    const uint64_t seed = new_shuffle_seed();
+    const long long blocks = (long long)((local_data_size + SHUFFLE_BLOCK - 1) / SHUFFLE_BLOCK);
+    float* data = rawFloatData;
+
+    #pragma omp parallel for schedule(static)
+    for (long long b = 0; b < blocks; ++b)
+    {
+        const size_t begin = (size_t)b * SHUFFLE_BLOCK;
+        const size_t size = std::min<size_t>(SHUFFLE_BLOCK, local_data_size - begin);
+        shuffle_block(data + begin, size, mix64(seed ^ (uint64_t)b));
+    }
+}
+
+// 生成一块数据并在块内洗牌，结果与 init_rawData + shuffle_rawData 中对应的块相同分布；
+// 由调用者所在的线程完成，供流水线执行器逐块生成
+void generate_block(size_t global_start, size_t n, float out[], uint64_t seed, uint64_t block)
+{
+    static const FeistelPermutation& permutation = global_permutation();
+    for (size_t i = 0; i < n; ++i)
     {
-        std::uniform_int_distribution<size_t> distrib(0, i);
-        size_t j = distrib(g);
-        std::swap(rawFloatData[i], rawFloatData[j]);
+        out[i] = static_cast<float>(permute_index(permutation, global_start + i) + 1);
     }
+    shuffle_block(out, n, mix64(seed ^ block));
 }
 
 // 初始化并打乱数据
@@ -0,0 +1,64 @@
+/*
+    运行时 CPU 分发：用 cpuid 检测指令集，选出本机可用的最快内核
+*/
+
+#include "kernels.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static bool kernel_supported(const KernelTable* table)
+{
+    // __builtin_cpu_supports 同时检查 CPU 与操作系统（XCR0）是否支持对应寄存器状态
+    if (table == &g_kernels_avx512)
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (table == &g_kernels_avx2)
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (table == &g_kernels_sse2)
+        return __builtin_cpu_supports("sse2");
+    return true;
+}
+
+static const KernelTable* select_kernels()
+{
+    // 按从快到慢的顺序排列
+    const KernelTable* candidates[] = {&g_kernels_avx512, &g_kernels_avx2, &g_kernels_sse2, &g_kernels_scalar};
+    const int count = sizeof(candidates) / sizeof(candidates[0]);
+
+    __builtin_cpu_init();
+
+    const KernelTable* chosen = nullptr;
+    const char* forced = getenv("PARDIST_ISA");
+    if (forced != nullptr && forced[0] != '\0')
+    {
+        int match = -1;
+        for (int i = 0; i < count; i++)
+        {
+            if (strcmp(forced, candidates[i]->name) == 0)
+                match = i;
+        }
+
+        if (match < 0)
+            printf("[CPU] 未知的 PARDIST_ISA=%s（可选 scalar/sse2/avx2/avx512），改为自动选择\n", forced);
+        else if (!kernel_supported(candidates[match]))
+            printf("[CPU] 本机不支持 PARDIST_ISA=%s，改为自动选择\n", forced);
+        else
+            chosen = candidates[match];
+    }
+
+    for (int i = 0; chosen == nullptr && i < count; i++)
+    {
+        if (kernel_supported(candidates[i]))
+            chosen = candidates[i];
+    }
+
+    printf("[CPU] 加速内核: %s\n", chosen->name);
+    return chosen;
+}
+
+const KernelTable& speedup_kernels()
+{
+    static const KernelTable* table = select_kernels();  // C++11 保证只初始化一次
+    return *table;
+}
@@ -0,0 +1,473 @@
+/*
+    外部排序：数据大于内存预算时，分段在内存中变换、排序后写入临时文件，再 k 路归并
+    - 生成阶段：两块段缓冲区交替使用，一块在后台写盘时另一块计算键并排序
+    - 归并阶段：每个段两块读缓冲区，消费当前块时后台预读下一块；输出同样双缓冲后台写出
+    所有读写由一个后台 I/O 线程按提交顺序执行，计算线程只在缓冲区需要复用时等待
+    对输入数据排序时逐段从输入源加载：合成数据与 stream 模式每次只生成/读入一段，mmap 模式每次只映射一段
+    峰值内存（不含输入数据的映射）不超过预算
+*/
+
+#include "common.hpp"
+#include "input.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define EXTERNAL_MIN_BLOCK 4096         // 归并阶段每块至少的元素个数
+
+size_t external_sort_budget()
+{
+    const char* mb = getenv("PARDIST_SORT_MEMORY_MB");
+    size_t value = (mb != nullptr) ? (size_t)strtoull(mb, nullptr, 10) : 0;
+    if (value == 0)
+        value = EXTERNAL_SORT_DEFAULT_MB;
+    return value << 20;
+}
+
+const char* external_sort_temp_dir()
+{
+    const char* dir = getenv("PARDIST_SORT_TMPDIR");
+    if (dir == nullptr || dir[0] == '\0')
+        dir = getenv("TMPDIR");
+    return (dir != nullptr && dir[0] != '\0') ? dir : "/tmp";
+}
+
+// ===== 后台 I/O 线程 =====
+
+struct IoRequest
+{
+    int fd;
+    bool write;
+    off_t offset;
+    char* buffer;
+    size_t bytes;
+    bool done;
+    bool failed;
+};
+
+struct IoQueue
+{
+    std::mutex mutex;
+    std::condition_variable submitted;
+    std::condition_variable completed;
+    std::deque<IoRequest*> pending;
+    bool stop;
+};
+
+static bool io_transfer(IoRequest* r)
+{
+    size_t done = 0;
+    while (done < r->bytes)
+    {
+        ssize_t n = r->write ? pwrite(r->fd, r->buffer + done, r->bytes - done, r->offset + (off_t)done)
+                             : pread(r->fd, r->buffer + done, r->bytes - done, r->offset + (off_t)done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        done += (size_t)n;
+    }
+    return true;
+}
+
+static void io_thread_main(IoQueue* q)
+{
+    std::unique_lock<std::mutex> lock(q->mutex);
+    while (true)
+    {
+        q->submitted.wait(lock, [q] { return q->stop || !q->pending.empty(); });
+        if (q->pending.empty())
+            return;
+        IoRequest* r = q->pending.front();
+        q->pending.pop_front();
+
+        lock.unlock();
+        bool ok = io_transfer(r);
+        lock.lock();
+
+        r->failed = !ok;
+        r->done = true;
+        q->completed.notify_all();
+    }
+}
+
+static void io_submit(IoQueue* q, IoRequest* r, int fd, bool write, off_t offset, void* buffer, size_t bytes)
+{
+    r->fd = fd;
+    r->write = write;
+    r->offset = offset;
+    r->buffer = (char*)buffer;
+    r->bytes = bytes;
+    r->done = false;
+    r->failed = false;
+    std::lock_guard<std::mutex> lock(q->mutex);
+    q->pending.push_back(r);
+    q->submitted.notify_one();
+}
+
+// 等待请求完成；从未提交过的请求（bytes 为 0）直接返回
+static bool io_wait(IoQueue* q, IoRequest* r)
+{
+    if (r->bytes == 0)
+        return true;
+    std::unique_lock<std::mutex> lock(q->mutex);
+    q->completed.wait(lock, [r] { return r->done; });
+    r->bytes = 0;
+    return !r->failed;
+}
+
+// ===== 归并阶段的段读取游标 =====
+
+struct RunCursor
+{
+    float* blocks[2];       // 当前块与预读块
+    IoRequest request;      // 预读块的读请求
+    const float* cur;
+    size_t pos;
+    size_t avail;           // 当前块的元素个数
+    off_t next_offset;      // 下一次读取的文件偏移
+    size_t remaining;       // 尚未提交读取的元素个数
+    int active;             // 当前块是 blocks[0] 还是 blocks[1]
+};
+
+static void run_prefetch(IoQueue* q, int fd, RunCursor* c, size_t block)
+{
+    if (c->remaining == 0)
+        return;
+    size_t n = std::min(c->remaining, block);
+    io_submit(q, &c->request, fd, false, c->next_offset, c->blocks[1 - c->active], n * sizeof(float));
+    c->next_offset += (off_t)(n * sizeof(float));
+    c->remaining -= n;
+}
+
+// 当前块用完后切换到预读块，并开始预读再下一块；段读完返回 false
+static bool run_advance(IoQueue* q, int fd, RunCursor* c, size_t block, bool* io_ok)
+{
+    size_t n = c->request.bytes / sizeof(float);
+    if (n == 0)
+        return false;
+    *io_ok = io_wait(q, &c->request) && *io_ok;
+    c->active = 1 - c->active;
+    c->cur = c->blocks[c->active];
+    c->pos = 0;
+    c->avail = n;
+    run_prefetch(q, fd, c, block);
+    return true;
+}
+
+// 小顶堆：heap[i] 为段编号，按各段当前的键比较
+static inline float run_head(const RunCursor* runs, int r)
+{
+    return runs[r].cur[runs[r].pos];
+}
+
+static void heap_sift_down(int heap[], int size, int i, const RunCursor* runs)
+{
+    while (true)
+    {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < size && run_head(runs, heap[left]) < run_head(runs, heap[smallest]))
+            smallest = left;
+        if (right < size && run_head(runs, heap[right]) < run_head(runs, heap[smallest]))
+            smallest = right;
+        if (smallest == i)
+            return;
+        std::swap(heap[i], heap[smallest]);
+        i = smallest;
+    }
+}
+
+static double elapsed_ms(const struct timespec& start, const struct timespec& end)
+{
+    return (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+// 生成阶段的数据来源：内存中的数组，或者按段从输入源（input.hpp）加载
+struct RunSource
+{
+    const float* data;      // 为 nullptr 时从输入源加载
+};
+
+// 取得全局下标 [begin, begin + n) 的原始数据；从输入源加载时覆盖上一段，失败返回 nullptr
+static const float* load_run(const RunSource& source, size_t begin, size_t n)
+{
+    if (source.data != nullptr)
+        return source.data + begin;
+
+    float* data = input_prepare(begin, n);
+    if (data == nullptr)
+        return nullptr;
+    const long long blocks = (long long)((n + SHUFFLE_BLOCK - 1) / SHUFFLE_BLOCK);
+    bool ok = true;
+    #pragma omp parallel for schedule(static) reduction(&&:ok)
+    for (long long b = 0; b < blocks; ++b)
+    {
+        const size_t offset = (size_t)b * SHUFFLE_BLOCK;
+        ok = input_fill_block(offset, std::min<size_t>(SHUFFLE_BLOCK, n - offset)) && ok;
+    }
+    if (!ok)
+    {
+        printf("[ExternalSort] 读取输入区间 [%zu, %zu) 失败: %s\n", begin, begin + n, strerror(errno));
+        return nullptr;
+    }
+    return data;
+}
+
+// run_elems 为每段的元素个数；staging 为从输入源加载时每段占用的额外内存（计入峰值）
+static size_t external_sort(const RunSource& source, size_t len, size_t run_elems, size_t staging_bytes,
+                            size_t budget_bytes, const char* temp_dir, int out_fd, ExternalSortStats* stats)
+{
+    ExternalSortStats local_stats;
+    memset(&local_stats, 0, sizeof(local_stats));
+    struct timespec t0, t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    const size_t runs_count = (len + run_elems - 1) / run_elems;
+
+    // 临时文件创建后立即删除，进程退出时由系统回收
+    std::string path = std::string(temp_dir) + "/pardist-runs-XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    int fd = mkstemp(name.data());
+    if (fd < 0)
+    {
+        printf("[ExternalSort] 无法在 %s 创建临时文件: %s\n", temp_dir, strerror(errno));
+        return 0;
+    }
+    unlink(name.data());
+
+    IoQueue queue;
+    queue.stop = false;
+    std::thread io_thread(io_thread_main, &queue);
+    bool io_ok = true;
+    size_t written = 0;
+
+    // ===== 1. 生成有序段 =====
+    {
+        const size_t first_run = std::min(run_elems, len);
+        float* buffers[2] = {new float[first_run], new float[runs_count > 1 ? first_run : 1]};
+        float* temp = new float[first_run];
+        IoRequest writes[2];
+        writes[0].bytes = writes[1].bytes = 0;
+
+        for (size_t r = 0; r < runs_count; r++)
+        {
+            const size_t begin = r * run_elems;
+            const size_t n = std::min(run_elems, len - begin);
+            float* buf = buffers[r & 1];
+            io_ok = io_wait(&queue, &writes[r & 1]) && io_ok;   // 两段之前写出的这块缓冲区已经落盘
+            const float* data = load_run(source, begin, n);
+            if (data == nullptr)
+            {
+                io_ok = false;
+                break;
+            }
+            computeSortKeys(data, (int)n, buf);
+            sortKeys(sort_backend(), buf, n, temp);
+            io_submit(&queue, &writes[r & 1], fd, true, (off_t)(begin * sizeof(float)), buf, n * sizeof(float));
+        }
+        io_ok = io_wait(&queue, &writes[0]) && io_ok;
+        io_ok = io_wait(&queue, &writes[1]) && io_ok;
+
+        delete[] buffers[0];
+        delete[] buffers[1];
+        delete[] temp;
+        local_stats.peak_bytes = ((runs_count > 1 ? 2 : 1) * first_run + first_run) * sizeof(float) + staging_bytes;
+        if (source.data == nullptr)
+            input_release();    // 归并阶段不再需要输入数据，把预算留给读缓冲区
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    // ===== 2. k 路归并 =====
+    // 每段两块读缓冲区，另加两块输出缓冲区
+    if (io_ok && len > 0)
+    {
+        const int k = (int)runs_count;
+        const size_t block = std::max<size_t>(budget_bytes / ((2 * runs_count + 2) * sizeof(float)), EXTERNAL_MIN_BLOCK);
+        if (block == EXTERNAL_MIN_BLOCK && budget_bytes / ((2 * runs_count + 2) * sizeof(float)) < EXTERNAL_MIN_BLOCK)
+        {
+            printf("[ExternalSort] 内存预算不足以容纳 %d 个段的缓冲区，按每块 %d 个元素执行\n", k, EXTERNAL_MIN_BLOCK);
+        }
+
+        std::vector<RunCursor> runs(k);
+        std::vector<int> heap;
+        for (int r = 0; r < k; r++)
+        {
+            RunCursor* c = &runs[r];
+            c->blocks[0] = new float[block];
+            c->blocks[1] = new float[block];
+            c->request.bytes = 0;
+            c->active = 1;                  // 第一次预读写入 blocks[0]
+            c->next_offset = (off_t)((size_t)r * run_elems * sizeof(float));
+            c->remaining = std::min(run_elems, len - (size_t)r * run_elems);
+            c->avail = 0;
+            c->pos = 0;
+            run_prefetch(&queue, fd, c, block);
+        }
+        for (int r = 0; r < k; r++)
+        {
+            if (run_advance(&queue, fd, &runs[r], block, &io_ok))
+                heap.push_back(r);
+        }
+        int heap_size = (int)heap.size();
+        for (int i = heap_size / 2 - 1; i >= 0; i--)
+            heap_sift_down(heap.data(), heap_size, i, runs.data());
+
+        float* out[2] = {new float[block], new float[block]};
+        IoRequest out_writes[2];
+        out_writes[0].bytes = out_writes[1].bytes = 0;
+        int out_active = 0;
+        size_t out_count = 0;
+
+        while (heap_size > 0)
+        {
+            RunCursor* c = &runs[heap[0]];
+            out[out_active][out_count++] = c->cur[c->pos++];
+
+            if (c->pos == c->avail && !run_advance(&queue, fd, c, block, &io_ok))
+            {
+                heap[0] = heap[--heap_size];  // 该段归并完毕
+            }
+            heap_sift_down(heap.data(), heap_size, 0, runs.data());
+
+            if (out_count == block || heap_size == 0)
+            {
+                if (out_fd >= 0)
+                {
+                    io_submit(&queue, &out_writes[out_active], out_fd, true, (off_t)(written * sizeof(float)),
+                              out[out_active], out_count * sizeof(float));
+                    out_active = 1 - out_active;
+                    io_ok = io_wait(&queue, &out_writes[out_active]) && io_ok;
+                }
+                written += out_count;
+                out_count = 0;
+            }
+        }
+        io_ok = io_wait(&queue, &out_writes[0]) && io_ok;
+        io_ok = io_wait(&queue, &out_writes[1]) && io_ok;
+
+        delete[] out[0];
+        delete[] out[1];
+        for (int r = 0; r < k; r++)
+        {
+            delete[] runs[r].blocks[0];
+            delete[] runs[r].blocks[1];
+        }
+        local_stats.peak_bytes = std::max(local_stats.peak_bytes, (2 * runs_count + 2) * block * sizeof(float));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.stop = true;
+        queue.submitted.notify_one();
+    }
+    io_thread.join();
+    close(fd);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    if (!io_ok)
+    {
+        printf("[ExternalSort] 读写临时文件或输出文件失败: %s\n", strerror(errno));
+    }
+
+    local_stats.runs = runs_count;
+    local_stats.run_ms = elapsed_ms(t0, t1);
+    local_stats.merge_ms = elapsed_ms(t1, t2);
+    if (stats != nullptr)
+        *stats = local_stats;
+    return io_ok ? written : 0;
+}
+
+size_t externalSortKeys(const float data[], size_t len, size_t budget_bytes, const char* temp_dir,
+                        int out_fd, ExternalSortStats* stats)
+{
+    // 生成阶段占用两块段缓冲区和一块排序辅助数组
+    const size_t run_elems = std::max<size_t>(budget_bytes / (3 * sizeof(float)), EXTERNAL_MIN_BLOCK);
+    RunSource source;
+    source.data = data;
+    return external_sort(source, len, run_elems, 0, budget_bytes, temp_dir, out_fd, stats);
+}
+
+size_t externalSortInput(size_t budget_bytes, const char* temp_dir, int out_fd, ExternalSortStats* stats)
+{
+    // 合成数据与 stream 模式的每段先生成/读入一块与段同样大小的匿名内存，预算按四块段缓冲区划分；
+    // mmap 模式只映射当前段，页面属于页缓存，与 externalSortKeys 一样按三块划分
+    const bool staged = (input_kind() != INPUT_MMAP);
+    const size_t run_elems = std::max<size_t>(budget_bytes / ((staged ? 4 : 3) * sizeof(float)), EXTERNAL_MIN_BLOCK);
+    const size_t len = input_total();
+    RunSource source;
+    source.data = nullptr;
+    return external_sort(source, len, run_elems, staged ? std::min(run_elems, len) * sizeof(float) : 0,
+                         budget_bytes, temp_dir, out_fd, stats);
+}
+
+// 逐块读回输出文件，检查个数与有序性
+static bool verify_sorted_file(int fd, size_t expected)
+{
+    const size_t block = 1 << 20;
+    float* buf = new float[block];
+    size_t count = 0;
+    float last = 0.0f;
+    bool ok = true;
+    while (ok)
+    {
+        ssize_t n = pread(fd, buf, block * sizeof(float), (off_t)(count * sizeof(float)));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        size_t elems = (size_t)n / sizeof(float);
+        ok = (count == 0 || last <= buf[0]) && std::is_sorted(buf, buf + elems);
+        last = buf[elems - 1];
+        count += elems;
+    }
+    delete[] buf;
+    return ok && count == expected;
+}
+
+void run_external_sort()
+{
+    const size_t total = input_total();
+    const size_t budget = external_sort_budget();
+    const char* temp_dir = external_sort_temp_dir();
+    const char* output = getenv("PARDIST_SORT_OUTPUT");
+    int out_fd = -1;
+    if (output != nullptr && output[0] != '\0')
+    {
+        out_fd = open(output, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (out_fd < 0)
+        {
+            printf("[ExternalSort] 无法创建输出文件 %s: %s\n", output, strerror(errno));
+            return;
+        }
+    }
+
+    printf("\n[ExternalSort] %zu 个元素（%s），内存预算 %zu MB，临时目录 %s\n", total,
+           input_kind_name(input_kind()), budget >> 20, temp_dir);
+    ExternalSortStats stats;
+    size_t sorted = externalSortInput(budget, temp_dir, out_fd, &stats);
+    printf("[ExternalSort] %zu 个有序段，生成 %.2f ms，归并 %.2f ms，缓冲区峰值 %.1f MB，输出 %zu 个元素\n",
+           stats.runs, stats.run_ms, stats.merge_ms, stats.peak_bytes / 1048576.0, sorted);
+
+    if (out_fd >= 0)
+    {
+        printf("[ExternalSort] 输出文件 %s，有序性校验: %s\n", output,
+               verify_sorted_file(out_fd, total) ? "通过" : "失败");
+        close(out_fd);
+    }
+    input_release();
+}
@@ -0,0 +1,277 @@
+/*
+    输入数据源：合成数据、映射文件或分块读取文件，各节点只触及自己的分段
+*/
+
+#include "input.hpp"
+#include "common.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+// 当前映射：合成数据与 stream 模式共用一块匿名映射（可复用），mmap 模式为文件映射
+static void* g_mapBase = nullptr;
+static size_t g_mapLength = 0;
+static bool g_mapAnonymous = false;
+static size_t g_firstTouchCount = 0;    // 匿名映射的页面按多少个元素的 static 划分首次触及
+
+static int g_inputFd = -1;
+static size_t g_inputTotal = 0;
+
+// 当前分段：全局起始下标与本轮合成数据的洗牌种子
+static size_t g_partitionStart = 0;
+static uint64_t g_shuffleSeed = 0;
+
+static int open_input()
+{
+    const char* path = getenv("PARDIST_INPUT_FILE");
+    if (path == nullptr || path[0] == '\0')
+    {
+        g_inputTotal = DATANUM;
+        return INPUT_SYNTHETIC;
+    }
+
+    int kind = INPUT_MMAP;
+    const char* mode = getenv("PARDIST_INPUT_MODE");
+    if (mode != nullptr && strcmp(mode, "stream") == 0)
+        kind = INPUT_STREAM;
+    else if (mode != nullptr && strcmp(mode, "mmap") != 0)
+        printf("[Input] 未知的 PARDIST_INPUT_MODE=%s（可选 mmap/stream），使用 mmap\n", mode);
+
+    struct stat st;
+    g_inputFd = open(path, O_RDONLY | O_CLOEXEC);
+    if (g_inputFd < 0 || fstat(g_inputFd, &st) < 0)
+    {
+        printf("[Input] 无法打开 %s: %s，改用合成数据\n", path, strerror(errno));
+        if (g_inputFd >= 0)
+            close(g_inputFd);
+        g_inputFd = -1;
+        g_inputTotal = DATANUM;
+        return INPUT_SYNTHETIC;
+    }
+
+    // 各处的长度参数为 int，超出部分不参与计算
+    g_inputTotal = (size_t)st.st_size / sizeof(float);
+    if (g_inputTotal > (size_t)INT_MAX)
+    {
+        printf("[Input] %s 超过 %d 个元素，只使用前 %d 个\n", path, INT_MAX, INT_MAX);
+        g_inputTotal = INT_MAX;
+    }
+    printf("[Input] %s: %zu 个 float (%s)\n", path, g_inputTotal, input_kind_name(kind));
+    return kind;
+}
+
+int input_kind()
+{
+    static const int kind = open_input();  // C++11 保证只初始化一次
+    return kind;
+}
+
+const char* input_kind_name(int kind)
+{
+    switch (kind)
+    {
+        case INPUT_MMAP:   return "mmap";
+        case INPUT_STREAM: return "stream";
+        default:           return "synthetic";
+    }
+}
+
+size_t input_total()
+{
+    input_kind();
+    return g_inputTotal;
+}
+
+void input_release()
+{
+    if (g_mapBase != nullptr)
+    {
+        munmap(g_mapBase, g_mapLength);
+    }
+    g_mapBase = nullptr;
+    g_mapLength = 0;
+    g_mapAnonymous = false;
+    g_firstTouchCount = 0;
+    rawFloatData = nullptr;
+}
+
+// 本机 NUMA 节点个数（/sys/devices/system/node/nodeN 的个数），读不到时视为 1
+static int numa_node_count()
+{
+    DIR* dir = opendir("/sys/devices/system/node");
+    if (dir == nullptr)
+        return 1;
+    int count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9')
+            count++;
+    }
+    closedir(dir);
+    return (count > 0) ? count : 1;
+}
+
+// 分段不超过物理内存的一半时才预先读入，否则交给内核按顺序预读
+static bool should_populate(size_t bytes)
+{
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+    return pages > 0 && page_size > 0 && bytes <= (size_t)pages * (size_t)page_size / 2;
+}
+
+float* input_synthetic_buffer(size_t count)
+{
+    const size_t bytes = std::max<size_t>(count, 1) * sizeof(float);
+    if (g_mapAnonymous && g_mapLength >= bytes)
+    {
+        // 多 NUMA 节点时，划分大小变了则各线程负责的地址段也变了：丢弃旧页面，
+        // 由接下来并行写入的线程重新首次触及，页面落在之后计算它的线程所在的节点
+        static const bool numa = numa_node_count() > 1;
+        if (numa && count != g_firstTouchCount)
+        {
+            madvise(g_mapBase, g_mapLength, MADV_DONTNEED);
+        }
+        g_firstTouchCount = count;
+        rawFloatData = (float*)g_mapBase;
+        return rawFloatData;
+    }
+
+    // 匿名映射在首次写入时才分配物理页，不需要像静态数组那样整体清零
+    input_release();
+    void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        printf("[Input] 分配 %zu 字节失败: %s\n", bytes, strerror(errno));
+        return nullptr;
+    }
+    madvise(base, bytes, MADV_HUGEPAGE);  // 大页减少 TLB 缺失；内核未开启透明大页时忽略
+    g_mapBase = base;
+    g_mapLength = bytes;
+    g_mapAnonymous = true;
+    g_firstTouchCount = count;
+    rawFloatData = (float*)base;
+    return rawFloatData;
+}
+
+static float* map_partition(size_t start, size_t count)
+{
+    input_release();
+
+    // 映射的文件偏移必须按页对齐，返回的指针再跳过对齐多出的部分
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t offset = start * sizeof(float);
+    const size_t aligned = offset / page * page;
+    const size_t length = offset - aligned + std::max<size_t>(count, 1) * sizeof(float);
+
+    const bool populate = should_populate(length);
+    void* base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), g_inputFd, (off_t)aligned);
+    if (base == MAP_FAILED)
+    {
+        printf("[Input] 映射文件区间失败: %s\n", strerror(errno));
+        return nullptr;
+    }
+    // 只读顺序扫描；支持大页缓存的文件系统上同样可以用大页映射
+    madvise(base, length, MADV_SEQUENTIAL);
+    madvise(base, length, MADV_HUGEPAGE);
+    g_mapBase = base;
+    g_mapLength = length;
+    g_mapAnonymous = false;
+    rawFloatData = (float*)((char*)base + (offset - aligned));
+    return rawFloatData;
+}
+
+// 读取分段内 [offset, offset + n) 的文件数据，读完即丢弃页缓存中的副本
+static bool read_range(size_t offset, size_t n)
+{
+    const off_t begin = (off_t)((g_partitionStart + offset) * sizeof(float));
+    char* dst = (char*)(rawFloatData + offset);
+    const size_t bytes = n * sizeof(float);
+    size_t done = 0;
+    while (done < bytes)
+    {
+        ssize_t got = pread(g_inputFd, dst + done, bytes - done, begin + (off_t)done);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+        done += (size_t)got;
+    }
+    posix_fadvise(g_inputFd, begin, (off_t)bytes, POSIX_FADV_DONTNEED);
+    return true;
+}
+
+float* input_prepare(size_t start, size_t count)
+{
+    const int kind = input_kind();
+    if (start + count > g_inputTotal)
+    {
+        printf("[Input] 分段 [%zu, %zu) 超出输入数据范围（%zu 个元素）\n", start, start + count, g_inputTotal);
+        return nullptr;
+    }
+
+    g_partitionStart = start;
+    g_shuffleSeed = new_shuffle_seed();
+    if (kind == INPUT_MMAP)
+    {
+        return map_partition(start, count);
+    }
+    float* data = input_synthetic_buffer(count);
+    if (data != nullptr && kind == INPUT_STREAM)
+    {
+        posix_fadvise(g_inputFd, (off_t)(start * sizeof(float)), (off_t)(count * sizeof(float)), POSIX_FADV_SEQUENTIAL);
+    }
+    return data;
+}
+
+bool input_fill_block(size_t offset, size_t n)
+{
+    switch (input_kind())
+    {
+        case INPUT_SYNTHETIC:
+            generate_block(g_partitionStart + offset, n, rawFloatData + offset, g_shuffleSeed, offset / SHUFFLE_BLOCK);
+            return true;
+        case INPUT_STREAM:
+            return read_range(offset, n);
+        default:
+            return true;    // 映射的页面在首次访问时由内核读入
+    }
+}
+
+float* load_partition(size_t start, size_t count)
+{
+    float* data = input_prepare(start, count);
+    if (data == nullptr)
+        return nullptr;
+
+    // 与加速内核相同的 static 划分逐块填充，页面由之后计算它的线程首次触及
+    const long long blocks = (long long)((count + SHUFFLE_BLOCK - 1) / SHUFFLE_BLOCK);
+    bool ok = true;
+    #pragma omp parallel for schedule(static) reduction(&&:ok)
+    for (long long b = 0; b < blocks; ++b)
+    {
+        const size_t offset = (size_t)b * SHUFFLE_BLOCK;
+        ok = input_fill_block(offset, std::min<size_t>(SHUFFLE_BLOCK, count - offset)) && ok;
+    }
+    if (!ok)
+    {
+        printf("[Input] 读取文件失败: %s\n", strerror(errno));
+        return nullptr;
+    }
+
+    if (input_kind() == INPUT_SYNTHETIC)
+        printf("[数据已初始化并打乱完成]\n");
+    else
+        printf("[数据已从文件加载: 全局下标 [%zu, %zu)]\n", start, start + count);
+    return data;
+}
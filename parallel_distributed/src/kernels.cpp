@@ -0,0 +1,356 @@
+/*
+    加速版 Sum/Max/键变换/合并内核，本文件由 CMake 以不同指令集选项编译多次：
+    simd_math.hpp 按编译目标选出 vfloat 的宽度，PARDIST_KERNEL_TABLE 给出本次编译导出的内核表名
+    注意：这里不要使用会在其他翻译单元中实例化的 inline/模板函数（如 <algorithm>、<cmath>），
+    否则链接器可能选中 AVX-512 编译出的副本，在不支持的机器上执行非法指令
+*/
+#include "kernels.hpp"
+#include "simd_math.hpp"
+
+#include <omp.h>        // OpenMP
+
+#ifndef PARDIST_KERNEL_TABLE
+#error "PARDIST_KERNEL_TABLE must name the exported kernel table"
+#endif
+
+// 每次迭代处理的向量个数：4 组独立的累加/最大值寄存器，隐藏 log 多项式的依赖链延迟
+#define SPEEDUP_UNROLL 4
+
+// 最大值的初值；std::numeric_limits 的 inline 成员在 -O0 下会生成弱符号，这里用编译器内建常量
+static const float NEG_INF = -__builtin_inff();
+
+/*
+    变换 f = scale * inner(x)：inner 的向量实现按变换重载（标签分发），
+    下面的 Sum/Max/键变换内核以变换为模板参数，循环结构只写一遍，编译时内联对应的 inner
+    新增变换只需在这里加一个重载并在内核表中实例化，不用改动循环
+    只读取变换的 scale 常量，不调用 reference 等 inline 成员函数（见文件开头的说明）
+*/
+static inline vfloat transform_inner(LogSqrtTransform, vfloat x) { return vlog(x); }   // log(sqrt(x)) = 0.5 * log(x)
+static inline vfloat transform_inner(SqrtTransform, vfloat x) { return vsqrt(x); }
+static inline vfloat transform_inner(SquareTransform, vfloat x) { return vmul(x, x); }
+
+// 尾部不足一个向量的 n 个元素：空位补 1.0 后按向量计算 inner，结果写回 lanes
+// 与主循环使用同一实现，同一个值无论落在哪个位置结果都相同
+template <typename Transform>
+static inline void transform_tail(const float* data, int n, float lanes[VLANES])
+{
+    for (int k = 0; k < VLANES; k++)
+        lanes[k] = (k < n) ? data[k] : 1.0f;
+    vstore(lanes, transform_inner(Transform(), vload(lanes)));
+}
+
+// 加速的求和函数 - 向量化变换 + 向量累加器 + OpenMP
+// 循环内只算 inner，最后乘一次 scale（log_sqrt 为 0.5）
+template <typename Transform>
+static float sum_kernel(const float data[], const int len)
+{
+    float total_sum = 0.0f;
+    const int step = VLANES * SPEEDUP_UNROLL;
+    const int limit = len - len % step;
+
+    #pragma omp parallel reduction(+:total_sum)
+    {
+        const Transform f = Transform();
+        vfloat acc0 = vset1(0.0f), acc1 = vset1(0.0f);
+        vfloat acc2 = vset1(0.0f), acc3 = vset1(0.0f);
+
+        #pragma omp for schedule(static) nowait
+        for (int i = 0; i < limit; i += step)
+        {
+            acc0 = vadd(acc0, transform_inner(f, vload(&data[i])));
+            acc1 = vadd(acc1, transform_inner(f, vload(&data[i + VLANES])));
+            acc2 = vadd(acc2, transform_inner(f, vload(&data[i + 2 * VLANES])));
+            acc3 = vadd(acc3, transform_inner(f, vload(&data[i + 3 * VLANES])));
+        }
+
+        // 每个线程只做一次水平归约
+        total_sum += vreduce_add(vadd(vadd(acc0, acc1), vadd(acc2, acc3)));
+
+        #pragma omp for nowait
+        for (int i = limit; i < len; i += VLANES)
+        {
+            const int n = (len - i < VLANES) ? len - i : VLANES;
+            float lanes[VLANES];
+            transform_tail<Transform>(&data[i], n, lanes);
+            for (int k = 0; k < n; k++)
+                total_sum += lanes[k];
+        }
+    }
+
+    return Transform::scale * total_sum;
+}
+
+// 加速的最大值函数 - 向量化变换 + 向量最大值寄存器 + OpenMP（scale > 0，最后乘一次不改变最大值的位置）
+template <typename Transform>
+static float max_kernel(const float data[], const int len)
+{
+    float global_max = NEG_INF;
+    const int step = VLANES * SPEEDUP_UNROLL;
+    const int limit = len - len % step;
+
+    #pragma omp parallel reduction(max:global_max)
+    {
+        const Transform f = Transform();
+        const vfloat neg_inf = vset1(NEG_INF);
+        vfloat max0 = neg_inf, max1 = neg_inf, max2 = neg_inf, max3 = neg_inf;
+
+        #pragma omp for schedule(static) nowait
+        for (int i = 0; i < limit; i += step)
+        {
+            max0 = vmax(max0, transform_inner(f, vload(&data[i])));
+            max1 = vmax(max1, transform_inner(f, vload(&data[i + VLANES])));
+            max2 = vmax(max2, transform_inner(f, vload(&data[i + 2 * VLANES])));
+            max3 = vmax(max3, transform_inner(f, vload(&data[i + 3 * VLANES])));
+        }
+
+        float local_max = vreduce_max(vmax(vmax(max0, max1), vmax(max2, max3)));
+        if (local_max > global_max)
+            global_max = local_max;
+
+        #pragma omp for nowait
+        for (int i = limit; i < len; i += VLANES)
+        {
+            const int n = (len - i < VLANES) ? len - i : VLANES;
+            float lanes[VLANES];
+            transform_tail<Transform>(&data[i], n, lanes);
+            for (int k = 0; k < n; k++)
+            {
+                if (lanes[k] > global_max)
+                    global_max = lanes[k];
+            }
+        }
+    }
+
+    return Transform::scale * global_max;
+}
+
+// 求和与最大值融合为一趟：每个变换结果同时进入累加器和最大值寄存器，数据只读一遍
+template <typename Transform>
+static void sum_max_kernel(const float data[], const int len, float* sum, float* max)
+{
+    float total_sum = 0.0f;
+    float global_max = NEG_INF;
+    const int step = VLANES * SPEEDUP_UNROLL;
+    const int limit = len - len % step;
+
+    #pragma omp parallel reduction(+:total_sum) reduction(max:global_max)
+    {
+        const Transform f = Transform();
+        const vfloat neg_inf = vset1(NEG_INF);
+        vfloat acc0 = vset1(0.0f), acc1 = vset1(0.0f);
+        vfloat acc2 = vset1(0.0f), acc3 = vset1(0.0f);
+        vfloat max0 = neg_inf, max1 = neg_inf, max2 = neg_inf, max3 = neg_inf;
+
+        #pragma omp for schedule(static) nowait
+        for (int i = 0; i < limit; i += step)
+        {
+            vfloat v0 = transform_inner(f, vload(&data[i]));
+            vfloat v1 = transform_inner(f, vload(&data[i + VLANES]));
+            vfloat v2 = transform_inner(f, vload(&data[i + 2 * VLANES]));
+            vfloat v3 = transform_inner(f, vload(&data[i + 3 * VLANES]));
+            acc0 = vadd(acc0, v0);
+            acc1 = vadd(acc1, v1);
+            acc2 = vadd(acc2, v2);
+            acc3 = vadd(acc3, v3);
+            max0 = vmax(max0, v0);
+            max1 = vmax(max1, v1);
+            max2 = vmax(max2, v2);
+            max3 = vmax(max3, v3);
+        }
+
+        total_sum += vreduce_add(vadd(vadd(acc0, acc1), vadd(acc2, acc3)));
+        float local_max = vreduce_max(vmax(vmax(max0, max1), vmax(max2, max3)));
+        if (local_max > global_max)
+            global_max = local_max;
+
+        #pragma omp for nowait
+        for (int i = limit; i < len; i += VLANES)
+        {
+            const int n = (len - i < VLANES) ? len - i : VLANES;
+            float lanes[VLANES];
+            transform_tail<Transform>(&data[i], n, lanes);
+            for (int k = 0; k < n; k++)
+            {
+                total_sum += lanes[k];
+                if (lanes[k] > global_max)
+                    global_max = lanes[k];
+            }
+        }
+    }
+
+    *sum = Transform::scale * total_sum;
+    *max = Transform::scale * global_max;
+}
+
+// 定点求和 + 最大值：与 sum_max_kernel 结构相同，累加器换成定点整数
+// int32 通道每累加 VFIXED_BATCH 个向量扩展一次到 int64；整数加法满足结合律，
+// 线程划分和合并顺序都不影响结果
+// 只有 log_sqrt 版本：定点格式按 log 值的范围（绝对值不超过 88.8）选定，见 simd_math.hpp
+static void sum_max_exact_kernel(const float data[], const int len, SumFixed* sum, float* max)
+{
+    SumFixed total_sum = 0;
+    float global_max = NEG_INF;
+    const int step = VLANES * SPEEDUP_UNROLL;
+    const int chunk = VLANES * VFIXED_BATCH;
+    const int limit = len - len % chunk;
+
+    #pragma omp parallel reduction(+:total_sum) reduction(max:global_max)
+    {
+        const vfloat neg_inf = vset1(NEG_INF);
+        vfloat max0 = neg_inf, max1 = neg_inf, max2 = neg_inf, max3 = neg_inf;
+        vfixed acc = vfixed_zero();
+
+        #pragma omp for schedule(static) nowait
+        for (int c = 0; c < limit; c += chunk)
+        {
+            vint part = vint_zero();
+            for (int i = c; i < c + chunk; i += step)
+            {
+                vfloat v0 = vlog(vload(&data[i]));
+                vfloat v1 = vlog(vload(&data[i + VLANES]));
+                vfloat v2 = vlog(vload(&data[i + 2 * VLANES]));
+                vfloat v3 = vlog(vload(&data[i + 3 * VLANES]));
+                part = vfixed_round(part, v0);
+                part = vfixed_round(part, v1);
+                part = vfixed_round(part, v2);
+                part = vfixed_round(part, v3);
+                max0 = vmax(max0, v0);
+                max1 = vmax(max1, v1);
+                max2 = vmax(max2, v2);
+                max3 = vmax(max3, v3);
+            }
+            acc = vfixed_widen_add(acc, part);
+        }
+
+        total_sum += vfixed_reduce(acc);
+        float local_max = vreduce_max(vmax(vmax(max0, max1), vmax(max2, max3)));
+        if (local_max > global_max)
+            global_max = local_max;
+
+        // 尾部同样用向量 log（空位补 1.0，log 为 0）：标量 log 与向量 log 可能相差 1 ULP，
+        // 若按位置选用不同实现，同一个值的定点舍入会随数据顺序和划分变化
+        #pragma omp for nowait
+        for (int i = limit; i < len; i += VLANES)
+        {
+            const int n = (len - i < VLANES) ? len - i : VLANES;
+            float lanes[VLANES];
+            for (int k = 0; k < VLANES; k++)
+                lanes[k] = (k < n) ? data[i + k] : 1.0f;
+            vfloat v = vlog(vload(lanes));
+            total_sum += vfixed_reduce(vfixed_widen_add(vfixed_zero(), vfixed_round(vint_zero(), v)));
+            vstore(lanes, v);
+            for (int k = 0; k < n; k++)
+            {
+                if (lanes[k] > global_max)
+                    global_max = lanes[k];
+            }
+        }
+    }
+
+    *sum = total_sum;
+    *max = 0.5f * global_max;
+}
+
+// 键变换：keys[i] = scale * inner(data[i])，每个元素只计算一次；逐元素写回，keys 可以就是 data
+template <typename Transform>
+static void keys_kernel(const float data[], const int len, float keys[])
+{
+    const int limit = len - len % VLANES;
+
+    #pragma omp parallel
+    {
+        const Transform f = Transform();
+        const vfloat scale = vset1(Transform::scale);
+
+        #pragma omp for schedule(static) nowait
+        for (int i = 0; i < limit; i += VLANES)
+        {
+            vstore(&keys[i], vmul(scale, transform_inner(f, vload(&data[i]))));
+        }
+
+        #pragma omp single nowait
+        if (limit < len)
+        {
+            float lanes[VLANES];
+            transform_tail<Transform>(&data[limit], len - limit, lanes);
+            for (int k = 0; k < len - limit; k++)
+                keys[limit + k] = Transform::scale * lanes[k];
+        }
+    }
+}
+
+// 无分支的标量合并：每步取较小者，用比较结果推进下标（相等时先取 a），编译为条件传送而不是跳转
+static void merge_branchless(const float* a, size_t na, const float* b, size_t nb, float* dst)
+{
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb)
+    {
+        const float x = a[i];
+        const float y = b[j];
+        const bool take_a = !(y < x);
+        dst[k++] = take_a ? x : y;
+        i += take_a;
+        j += !take_a;
+    }
+    while (i < na)
+        dst[k++] = a[i++];
+    while (j < nb)
+        dst[k++] = b[j++];
+}
+
+// 合并有序的 a[0, na) 与 b[0, nb) 到 dst（不能与输入重叠）：
+// 寄存器中保留 VLANES 个尚未输出的最大元素 hi，每次从首元素较小的一路读入一个向量，
+// 经双调合并网络后输出较小的 VLANES 个；任一路剩余不足一个向量时，hi 与两路的剩余部分按标量合并
+// 标量版本（VLANES 为 1）没有可以摊销的网络，直接用无分支合并
+static void merge_kernel(const float a[], size_t na, const float b[], size_t nb, float dst[])
+{
+    if (VLANES == 1 || na < VLANES || nb < VLANES)
+    {
+        merge_branchless(a, na, b, nb, dst);
+        return;
+    }
+
+    vfloat lo = vload(a);
+    vfloat hi = vload(b);
+    vbitonic_merge(&lo, &hi);
+    vstore(dst, lo);
+    size_t i = VLANES, j = VLANES, k = VLANES;
+
+    while (i + VLANES <= na && j + VLANES <= nb)
+    {
+        const bool take_a = !(b[j] < a[i]);
+        lo = vload(take_a ? a + i : b + j);
+        i += take_a ? VLANES : 0;
+        j += take_a ? 0 : VLANES;
+        vbitonic_merge(&lo, &hi);
+        vstore(dst + k, lo);
+        k += VLANES;
+    }
+
+    // hi 中的元素不小于已输出的任何元素；先与剩余较短（不足一个向量）的一路合并，再与另一路合并
+    float rest[VLANES];
+    float small[2 * VLANES];
+    vstore(rest, hi);
+    const bool a_short = (na - i < VLANES);
+    const float* s = a_short ? a + i : b + j;
+    const size_t ns = a_short ? na - i : nb - j;
+    const float* l = a_short ? b + j : a + i;
+    const size_t nl = a_short ? nb - j : na - i;
+    merge_branchless(rest, VLANES, s, ns, small);
+    merge_branchless(small, VLANES + ns, l, nl, dst + k);
+}
+
+// 一种变换的全部内核；表在编译期初始化，不依赖静态初始化顺序
+#define TRANSFORM_KERNELS(T) {sum_kernel<T>, max_kernel<T>, sum_max_kernel<T>, keys_kernel<T>}
+
+// 前几项为 log_sqrt 的实例（流水线、分布式各轮使用），transforms 的顺序与 TransformId 一致
+extern const KernelTable PARDIST_KERNEL_TABLE = {
+    VISA_NAME,
+    sum_kernel<LogSqrtTransform>,
+    max_kernel<LogSqrtTransform>,
+    sum_max_kernel<LogSqrtTransform>,
+    sum_max_exact_kernel,
+    keys_kernel<LogSqrtTransform>,
+    merge_kernel,
+    {TRANSFORM_KERNELS(LogSqrtTransform), TRANSFORM_KERNELS(SqrtTransform), TRANSFORM_KERNELS(SquareTransform)}
+};
@@ -0,0 +1,130 @@
+/*
+    负载均衡：启动时标定本机吞吐量，按吞吐量比例划分数据，
+    并根据每轮实际完成时间逐轮修正
+*/
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+#include <time.h>
+
+static double elapsed_seconds(const struct timespec& start, const struct timespec& end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// 用 sample 个元素运行一次加速版 Sum+Max（融合）与 Sort，得到每秒处理的元素个数
+// Sum 与 Max 在一趟内完成，融合耗时平分给两者，使 combined_rate 的公式保持不变
+NodeThroughput calibrate_throughput(size_t sample)
+{
+    NodeThroughput t;
+    struct timespec start, end;
+    float sum, max;
+
+    data_init_and_shuffle(0, sample);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sumMaxSpeedUp(rawFloatData, sample, &sum, &max);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    t.sum_rate = 2.0 * sample / elapsed_seconds(start, end);
+    t.max_rate = t.sum_rate;
+
+    float* sorted = new float[sample];
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sortSpeedUp(rawFloatData, sample, sorted);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    t.sort_rate = sample / elapsed_seconds(start, end);
+    delete[] sorted;
+
+    printf("[标定] Sum+Max %.1f M/s, Sort %.1f M/s, 综合 %.1f M/s (Sum %f, Max %f)\n",
+           t.sum_rate / 2e6, t.sort_rate / 1e6, combined_rate(t) / 1e6, sum, max);
+    return t;
+}
+
+// 一轮依次执行 Sum、Max、Sort，综合吞吐量按耗时相加折算
+double combined_rate(const NodeThroughput& t)
+{
+    return 1.0 / (1.0 / t.sum_rate + 1.0 / t.max_rate + 1.0 / t.sort_rate);
+}
+
+// 吞吐量的下限：Worker 上报的值未经校验，非有限或不大于 0 的值按此处理，使每个节点的比例都有意义
+static const double MIN_RATE = 1.0;
+
+// 按吞吐量比例划分 total 个元素（最大余数法保证总和不变），每段至少 MIN_PARTITION 个
+// 吞吐量之和不是正的有限值时（例如上报了极大的值）退回平均划分
+void balance_partition(const double rates[], int n, size_t total, size_t sizes[])
+{
+    double* weight = new double[n];
+    double rate_sum = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        weight[i] = (std::isfinite(rates[i]) && rates[i] > MIN_RATE) ? rates[i] : MIN_RATE;
+        rate_sum += weight[i];
+    }
+    if (!std::isfinite(rate_sum) || rate_sum <= 0.0)
+    {
+        for (int i = 0; i < n; i++)
+            weight[i] = 1.0;
+        rate_sum = n;
+    }
+
+    const size_t reserved = (size_t)MIN_PARTITION * n;
+    const size_t share = (total > reserved) ? total - reserved : 0;
+    size_t assigned = 0;
+    double* remainder = new double[n];
+    for (int i = 0; i < n; i++)
+    {
+        // 比例之和的舍入误差可能使 exact 略超过 share，截断到 share 以内
+        double exact = std::min((double)share, share * (weight[i] / rate_sum));
+        sizes[i] = (size_t)exact;
+        remainder[i] = exact - sizes[i];
+        assigned += sizes[i];
+    }
+
+    // 同样由于舍入，各段取整后之和可能超过 share，从最大的一段扣回
+    while (assigned > share)
+    {
+        int largest = 0;
+        for (int i = 1; i < n; i++)
+        {
+            if (sizes[i] > sizes[largest])
+                largest = i;
+        }
+        size_t excess = std::min(assigned - share, sizes[largest]);
+        sizes[largest] -= excess;
+        assigned -= excess;
+    }
+
+    // 余下的元素依次给小数部分最大的节点
+    for (size_t left = share - assigned; left > 0; left--)
+    {
+        int best = 0;
+        for (int i = 1; i < n; i++)
+        {
+            if (remainder[i] > remainder[best])
+                best = i;
+        }
+        sizes[best]++;
+        remainder[best] = -1.0;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        sizes[i] += (total > reserved) ? MIN_PARTITION : total / n + (i < (int)(total % n) ? 1 : 0);
+    }
+    delete[] remainder;
+    delete[] weight;
+}
+
+// 用本轮观测到的吞吐量（元素数 / 完成时间）平滑修正估计值
+double update_rate(double rate, size_t size, double elapsed_ms)
+{
+    if (elapsed_ms <= 0.0 || size == 0)
+    {
+        return rate;
+    }
+    double observed = size / (elapsed_ms / 1000.0);
+    return REBALANCE_ALPHA * observed + (1.0 - REBALANCE_ALPHA) * rate;
+}
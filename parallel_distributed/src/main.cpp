@@ -1,42 +1,286 @@
 /*
     主函数入口，从此进入客户端或服务器端测试
+    不带参数运行时显示交互式菜单；带命令行参数时（--mode 等）不读标准输入，便于脚本和 CI 无人值守运行
 */
 
 #include <iostream>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <omp.h>
 #include "common.hpp"
+#include "bench.hpp"
+#include "trace.hpp"
 #include "network_config.h"
 
-int main(int argc, char* argv[])
+enum RunMode
+{
+    MODE_NONE = 0,
+    MODE_SERVER,
+    MODE_CLIENT,
+    MODE_SORT_BENCH,
+    MODE_EXTERNAL_SORT,
+    MODE_BENCH
+};
+
+static void print_usage(const char* prog)
+{
+    printf("用法: %s [选项]（不带参数时进入交互式菜单）\n", prog);
+    printf("  -m, --mode MODE        server | client | bench | sort-bench | external-sort\n");
+    printf("  -w, --workers N        server: 等待加入的 Worker 个数\n");
+    printf("  -r, --rounds N         client: 测试轮数（以第一个加入的 Worker 为准）\n");
+    printf("  -s, --server IP        client: Server 地址（默认 %s）\n", SERVER_IP);
+    printf("  -p, --port N           Server 端口（默认 %d）\n", SERVER_PORT);
+    printf("  -n, --size N           bench: 元素个数（默认 DATANUM = %d）\n", DATANUM);
+    printf("  -o, --ops LIST         bench: 逗号分隔的操作，默认 %s\n", BENCH_DEFAULT_OPS);
+    printf("                         basic_sum,basic_max,basic_sort,sum,max,sum_max,sum_exact,sort,argsort\n");
+    printf("      --warmup N         bench: 每项的预热次数（默认 %d）；server: 不计入报告的前 N 轮（默认 0）\n",
+           BENCH_DEFAULT_WARMUP);
+    printf("      --reps N           bench: 每项的测量次数（默认 %d）\n", BENCH_DEFAULT_REPS);
+    printf("  -f, --format FMT       报告格式 table | csv | json（bench 默认 table；server 指定后才输出报告）\n");
+    printf("      --output FILE      报告写入文件（默认标准输出）\n");
+    printf("      --isa ISA          加速内核 scalar | sse2 | avx2 | avx512（同 PARDIST_ISA）\n");
+    printf("      --sort BACKEND     排序后端 radix | merge（同 PARDIST_SORT）\n");
+    printf("      --sum-mode MODE    求和模式 fast | exact（同 PARDIST_SUM_MODE）\n");
+    printf("      --dist-sort MODE   分布式排序 sample | gather（同 PARDIST_DIST_SORT）\n");
+    printf("      --transform NAME   bench: 逐元素变换 log_sqrt | sqrt | square（同 PARDIST_TRANSFORM，默认 log_sqrt）\n");
+    printf("  -t, --threads N        OpenMP 线程数\n");
+    printf("      --trace PREFIX     写出阶段追踪 PREFIX.<角色>.<pid>.json（Chrome trace，同 PARDIST_TRACE）\n");
+    printf("  -h, --help             显示本帮助\n");
+}
+
+// 解析正整数（不超过 limit），失败时打印提示并返回 -1
+static long long parse_count(const char* option, const char* text, long long limit)
+{
+    char* end = nullptr;
+    errno = 0;
+    long long value = strtoll(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0' || value < 0 || value > limit)
+    {
+        printf("选项 %s 的值无效: %s\n", option, text);
+        return -1;
+    }
+    return value;
+}
+
+static int parse_mode(const char* name)
+{
+    if (strcmp(name, "server") == 0)        return MODE_SERVER;
+    if (strcmp(name, "client") == 0)        return MODE_CLIENT;
+    if (strcmp(name, "bench") == 0)         return MODE_BENCH;
+    if (strcmp(name, "sort-bench") == 0)    return MODE_SORT_BENCH;
+    if (strcmp(name, "external-sort") == 0) return MODE_EXTERNAL_SORT;
+    return MODE_NONE;
+}
+
+// 原来的交互式菜单
+static int interactive_mode()
 {
-    printf("=== ParDist - Parallel Distributed Computing Tool ===\n");
-    printf("Configuration:\n");
-    printf("  Server IP: %s\n", SERVER_IP);
-    printf("  Server Port: %d\n", SERVER_PORT);
     printf("\n请选择模式（客户端或服务器端）:\n");
     printf("  1. Server\n");
     printf("  2. Client\n");
-    printf("输入选择 (1 或 2): ");
-    
-    int choice;  
+    printf("  3. 排序后端基准测试（单机）\n");
+    printf("  4. 外部排序（单机，数据可大于内存）\n");
+    printf("输入选择 (1、2、3 或 4): ");
+
+    int choice;
     std::cin >> choice;
-    
-    if (choice == 1)
+
+    switch (choice)
     {
-        printf("\nStarting in SERVER mode...\n");
-        run_server();
+        case 1:  return MODE_SERVER;
+        case 2:  return MODE_CLIENT;
+        case 3:  return MODE_SORT_BENCH;
+        case 4:  return MODE_EXTERNAL_SORT;
+        default: return MODE_NONE;
     }
-    else if (choice == 2)
+}
+
+int main(int argc, char* argv[])
+{
+    enum
+    {
+        OPT_WARMUP = 256,
+        OPT_REPS,
+        OPT_OUTPUT,
+        OPT_ISA,
+        OPT_SORT,
+        OPT_SUM_MODE,
+        OPT_DIST_SORT,
+        OPT_TRANSFORM,
+        OPT_TRACE
+    };
+    static const struct option long_options[] = {
+        {"mode", required_argument, nullptr, 'm'},
+        {"workers", required_argument, nullptr, 'w'},
+        {"rounds", required_argument, nullptr, 'r'},
+        {"server", required_argument, nullptr, 's'},
+        {"port", required_argument, nullptr, 'p'},
+        {"size", required_argument, nullptr, 'n'},
+        {"ops", required_argument, nullptr, 'o'},
+        {"warmup", required_argument, nullptr, OPT_WARMUP},
+        {"reps", required_argument, nullptr, OPT_REPS},
+        {"format", required_argument, nullptr, 'f'},
+        {"output", required_argument, nullptr, OPT_OUTPUT},
+        {"isa", required_argument, nullptr, OPT_ISA},
+        {"sort", required_argument, nullptr, OPT_SORT},
+        {"sum-mode", required_argument, nullptr, OPT_SUM_MODE},
+        {"dist-sort", required_argument, nullptr, OPT_DIST_SORT},
+        {"transform", required_argument, nullptr, OPT_TRANSFORM},
+        {"threads", required_argument, nullptr, 't'},
+        {"trace", required_argument, nullptr, OPT_TRACE},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    int mode = MODE_NONE;
+    long long workers = 0, rounds = 0, port = 0, warmup = -1;
+    const char* server_ip = nullptr;
+    BenchOptions bench;
+    bench.size = 0;
+    bench.ops = BENCH_DEFAULT_OPS;
+    bench.warmup = BENCH_DEFAULT_WARMUP;
+    bench.reps = BENCH_DEFAULT_REPS;
+    bench.output.format = BENCH_TABLE;
+    bench.output.path = nullptr;
+    bool report = false;    // server：指定了 --format 或 --output 时才写报告
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "m:w:r:s:p:n:o:f:t:h", long_options, nullptr)) != -1)
     {
-        printf("\nStarting in CLIENT mode...\n");
-        run_client();
+        long long value = 0;
+        switch (opt)
+        {
+            case 'm':
+                mode = parse_mode(optarg);
+                if (mode == MODE_NONE)
+                {
+                    printf("未知的模式: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'w':
+                if ((workers = parse_count("--workers", optarg, 65535)) <= 0) return 1;
+                break;
+            case 'r':
+                if ((rounds = parse_count("--rounds", optarg, 1000000)) <= 0) return 1;
+                break;
+            case 's':
+                server_ip = optarg;
+                break;
+            case 'p':
+                if ((port = parse_count("--port", optarg, 65535)) <= 0) return 1;
+                break;
+            case 'n':
+                if ((value = parse_count("--size", optarg, (long long)1 << 40)) <= 0) return 1;
+                bench.size = (size_t)value;
+                break;
+            case 'o':
+                bench.ops = optarg;
+                break;
+            case OPT_WARMUP:
+                if ((warmup = parse_count("--warmup", optarg, 1000000)) < 0) return 1;
+                break;
+            case OPT_REPS:
+                if ((value = parse_count("--reps", optarg, 1000000)) <= 0) return 1;
+                bench.reps = (int)value;
+                break;
+            case 'f':
+                bench.output.format = bench_format_from_name(optarg);
+                if (bench.output.format < 0)
+                {
+                    printf("未知的报告格式: %s（可选 table/csv/json）\n", optarg);
+                    return 1;
+                }
+                report = true;
+                break;
+            case OPT_OUTPUT:
+                bench.output.path = optarg;
+                report = true;
+                break;
+            // 以下选项与对应的环境变量等价，在各模块首次读取之前设置
+            case OPT_ISA:
+                setenv("PARDIST_ISA", optarg, 1);
+                break;
+            case OPT_SORT:
+                setenv("PARDIST_SORT", optarg, 1);
+                break;
+            case OPT_SUM_MODE:
+                setenv("PARDIST_SUM_MODE", optarg, 1);
+                break;
+            case OPT_DIST_SORT:
+                setenv("PARDIST_DIST_SORT", optarg, 1);
+                break;
+            case OPT_TRANSFORM:
+                setenv("PARDIST_TRANSFORM", optarg, 1);
+                break;
+            case OPT_TRACE:
+                setenv("PARDIST_TRACE", optarg, 1);
+                break;
+            case 't':
+                if ((value = parse_count("--threads", optarg, 4096)) <= 0) return 1;
+                omp_set_num_threads((int)value);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
     }
-    else
+    if (optind < argc)
     {
-        printf("Error: Invalid choice. Please enter 1 or 2.\n");
+        printf("多余的参数: %s\n", argv[optind]);
+        print_usage(argv[0]);
         return 1;
     }
+    set_server_address(server_ip, (int)port);
+    trace_init();
+    trace_set_thread_name("main");
 
-    return 0;
-}
+    printf("=== ParDist - Parallel Distributed Computing Tool ===\n");
+    printf("Configuration:\n");
+    printf("  Server IP: %s\n", server_ip != nullptr ? server_ip : SERVER_IP);
+    printf("  Server Port: %d\n", port > 0 ? (int)port : SERVER_PORT);
 
+    if (argc == 1)
+    {
+        mode = interactive_mode();
+    }
+    else if (mode == MODE_NONE)
+    {
+        printf("缺少 --mode\n");
+        print_usage(argv[0]);
+        return 1;
+    }
 
+    switch (mode)
+    {
+        case MODE_SERVER:
+            printf("\nStarting in SERVER mode...\n");
+            run_server((int)workers, warmup > 0 ? (int)warmup : 0, report ? &bench.output : nullptr);
+            break;
+        case MODE_CLIENT:
+            printf("\nStarting in CLIENT mode...\n");
+            run_client((int)rounds);
+            break;
+        case MODE_SORT_BENCH:
+            run_sort_benchmark();
+            break;
+        case MODE_EXTERNAL_SORT:
+            run_external_sort();
+            break;
+        case MODE_BENCH:
+            if (warmup >= 0)
+                bench.warmup = (int)warmup;
+            return run_bench(bench);
+        default:
+            printf("Error: Invalid choice. Please enter 1, 2, 3 or 4.\n");
+            return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+    分布式排序结果的流式多路归并
+    各输入流的数据可以边接收边归并：只读取 avail 已发布的前缀，
+    未到达的部分等待接收线程填充（由传输层的事件计数唤醒，不轮询）
+*/
+
+#include "common.hpp"
+#include "transport.hpp"
+#include "trace.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+// 当前可读的元素个数
+static size_t stream_ready(const SortedStream& s)
+{
+    if (s.avail == nullptr)
+    {
+        return s.total;
+    }
+    size_t n = s.avail->load(std::memory_order_acquire);
+    return (n < s.total) ? n : s.total;
+}
+
+// 在 [pos, ready) 中倍增查找第一个 > bound 的位置
+static size_t gallop_upper(const float* data, size_t pos, size_t ready, float bound)
+{
+    size_t lo = pos;
+    size_t step = 1;
+    while (lo + step < ready && data[lo + step] <= bound)
+    {
+        lo += step;
+        step <<= 1;
+    }
+    size_t hi = (lo + step < ready) ? lo + step : ready;
+
+    // data[lo] <= bound 成立，二分查找 (lo, hi) 区间
+    ++lo;
+    while (lo < hi)
+    {
+        size_t m = lo + (hi - lo) / 2;
+        if (data[m] <= bound)
+            lo = m + 1;
+        else
+            hi = m;
+    }
+    return lo;
+}
+
+// 多路流式归并：每次选出头部最小的流，把不超过次小头部的一段整体拷贝
+// 值域不相交时退化为按段 memcpy，值域交错时逐段推进
+size_t mergeSortedStreams(const SortedStream streams[], int k, float* result)
+{
+    TRACE_SCOPE("merge_streams", k);
+    size_t* pos = new size_t[k]();
+    size_t out = 0;
+    const int timeout_ms = transport_config().wait_timeout_ms;
+
+    while (true)
+    {
+        // 先记下事件计数再检查各流，检查之后到达的数据一定会唤醒下面的等待
+        const uint64_t seen = transport_events();
+        int best = -1;
+        float best_value = 0.0f;
+        float second_value = std::numeric_limits<float>::infinity();
+        bool waiting = false;
+        bool finished = true;
+
+        for (int s = 0; s < k; ++s)
+        {
+            if (pos[s] >= streams[s].total)
+            {
+                continue;
+            }
+            finished = false;
+
+            // 某一路还没有可读数据时无法确定最小值，只能等待
+            if (pos[s] >= stream_ready(streams[s]))
+            {
+                waiting = true;
+                break;
+            }
+
+            float head = streams[s].data[pos[s]];
+            if (best < 0 || head < best_value)
+            {
+                if (best >= 0 && best_value < second_value)
+                {
+                    second_value = best_value;
+                }
+                best = s;
+                best_value = head;
+            }
+            else if (head < second_value)
+            {
+                second_value = head;
+            }
+        }
+
+        if (finished)
+        {
+            break;
+        }
+        if (waiting)
+        {
+            TRACE_SCOPE("merge_wait", out);
+            if (!transport_wait_event(seen, timeout_ms))
+            {
+                break;  // 传输层已关闭或等待已取消（测试中止），不会再有数据到达
+            }
+            if (transport_events() == seen)
+            {
+                printf("[Merge] %d ms 内没有新数据到达，放弃归并\n", timeout_ms);
+                break;
+            }
+            continue;
+        }
+
+        const SortedStream& src = streams[best];
+        size_t end = gallop_upper(src.data, pos[best], stream_ready(src), second_value);
+        size_t n = end - pos[best];
+        memcpy(result + out, src.data + pos[best], n * sizeof(float));
+        out += n;
+        pos[best] = end;
+    }
+
+    delete[] pos;
+    return out;
+}
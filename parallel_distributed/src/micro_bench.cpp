@@ -0,0 +1,510 @@
+/*
+    微基准（pardist_bench）：不经过网络，单独测量 Basic 与 SpeedUp 版的 Sum/Max/排序
+    - 数据规模从 L1 可容纳的 1K 个元素起按 4 倍递增到 DATANUM（或 --max-size），
+      SpeedUp 版的线程数从 1 按 2 倍递增到全部核心；Basic 版是单线程的，只测 1 线程
+    - 每个样本是一批连续调用的平均用时（一批至少 MICRO_MIN_BATCH_MS，小规模不受计时器分辨率影响），
+      采样直到累计 --min-time 毫秒且至少 MICRO_MIN_SAMPLES 个样本
+    - 报告每秒元素数与字节数，并按规模列出 SpeedUp 版的线程扩展（加速比、效率、扩展在几线程处停止）
+    - --baseline 读入之前用 --format csv 保存的结果，任一项中位数吞吐量下降超过 --tolerance 时退出码为 2，
+      用于在修改内核前后把关
+*/
+
+#include "bench.hpp"
+#include "common.hpp"
+#include "input.hpp"
+#include "kernels.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <getopt.h>
+#include <time.h>
+#include <omp.h>
+
+#define MICRO_DEFAULT_MIN_SIZE 1024         // 4 KB，L1 内
+#define MICRO_DEFAULT_MIN_TIME_MS 200       // 每个 (操作, 规模, 线程数) 的最少累计测量时间
+#define MICRO_DEFAULT_TOLERANCE 10          // 与基线相比允许的吞吐量下降（百分比）
+#define MICRO_MIN_BATCH_MS 1.0
+#define MICRO_MIN_SAMPLES 3
+#define MICRO_MAX_SAMPLES 1000
+#define MICRO_SCALING_GAIN 1.1              // 线程数增加而吞吐量提升不足 10% 视为扩展停止
+
+static volatile float g_microSink;  // 保留 Sum/Max 的结果，避免被优化掉
+
+static void run_sum_basic(const float data[], int n) { g_microSink = sumBasic(data, n); }
+static void run_sum_speedup(const float data[], int n) { g_microSink = sumSpeedUp(data, n); }
+static void run_max_basic(const float data[], int n) { g_microSink = maxBasic(data, n); }
+static void run_max_speedup(const float data[], int n) { g_microSink = maxSpeedUp(data, n); }
+static void run_sort_basic(const float data[], int n) { sortBasic(data, n, arena_floats(ARENA_RESULT, n)); }
+static void run_sort_speedup(const float data[], int n) { sortSpeedUp(data, n, arena_floats(ARENA_RESULT, n)); }
+
+struct MicroBench
+{
+    const char* name;
+    void (*run)(const float data[], int n);
+    bool parallel;      // 是否扫描线程数
+};
+
+static const MicroBench g_microBenches[] = {
+    {"sumBasic", run_sum_basic, false},
+    {"sumSpeedUp", run_sum_speedup, true},
+    {"maxBasic", run_max_basic, false},
+    {"maxSpeedUp", run_max_speedup, true},
+    {"sortBasic", run_sort_basic, false},
+    {"sortSpeedUp", run_sort_speedup, true},
+};
+static const int g_microBenchCount = sizeof(g_microBenches) / sizeof(g_microBenches[0]);
+
+// 一个 (操作, 规模, 线程数) 组合的结果
+struct MicroResult
+{
+    int bench;
+    size_t size;
+    int threads;
+    double melems;      // 中位数吞吐量（百万元素/秒）
+};
+
+static void print_usage(const char* prog)
+{
+    printf("用法: %s [选项]\n", prog);
+    printf("  --filter LIST          逗号分隔，只运行名称包含其中任一项的操作（默认全部）\n");
+    printf("                         sumBasic,sumSpeedUp,maxBasic,maxSpeedUp,sortBasic,sortSpeedUp\n");
+    printf("  --min-size N           最小规模（默认 %d 个元素）\n", MICRO_DEFAULT_MIN_SIZE);
+    printf("  --max-size N           最大规模（默认 DATANUM = %d，文件输入时为文件中的元素个数）\n", DATANUM);
+    printf("  --threads LIST         逗号分隔的线程数（默认 1、2、4…直到 %d 个核心）\n", omp_get_num_procs());
+    printf("  --min-time MS          每项的最少累计测量时间（默认 %d ms）\n", MICRO_DEFAULT_MIN_TIME_MS);
+    printf("  --format FMT           报告格式 table | csv | json（默认 table）\n");
+    printf("  --output FILE          报告写入文件（默认标准输出）\n");
+    printf("  --baseline FILE        与之前 --format csv 保存的结果比较，吞吐量下降超过容差时退出码为 2\n");
+    printf("  --tolerance PCT        允许的吞吐量下降百分比（默认 %d）\n", MICRO_DEFAULT_TOLERANCE);
+    printf("  --isa ISA              加速内核 scalar | sse2 | avx2 | avx512（同 PARDIST_ISA）\n");
+    printf("  --sort BACKEND         排序后端 radix | merge（同 PARDIST_SORT）\n");
+    printf("  -h, --help             显示本帮助\n");
+}
+
+// 解析正整数（不超过 limit），失败时打印提示并返回 -1
+static long long parse_count(const char* option, const char* text, long long limit)
+{
+    char* end = nullptr;
+    errno = 0;
+    long long value = strtoll(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0' || value < 0 || value > limit)
+    {
+        printf("选项 %s 的值无效: %s\n", option, text);
+        return -1;
+    }
+    return value;
+}
+
+static std::vector<std::string> split_list(const char* list)
+{
+    std::vector<std::string> items;
+    const std::string text(list);
+    size_t begin = 0;
+    while (begin <= text.size())
+    {
+        size_t end = text.find(',', begin);
+        if (end == std::string::npos)
+            end = text.size();
+        if (end > begin)
+            items.push_back(text.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return items;
+}
+
+static bool parse_threads(const char* list, std::vector<int>& threads)
+{
+    const std::vector<std::string> items = split_list(list);
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        const long long value = parse_count("--threads", items[i].c_str(), 4096);
+        if (value <= 0)
+            return false;
+        threads.push_back((int)value);
+    }
+    return !threads.empty();
+}
+
+// 1、2、4…，最后一项为核心数
+static std::vector<int> default_threads()
+{
+    const int procs = omp_get_num_procs();
+    std::vector<int> threads;
+    for (int t = 1; t < procs; t *= 2)
+        threads.push_back(t);
+    threads.push_back(procs);
+    return threads;
+}
+
+// min_size、4 * min_size …，最后一项为 max_size
+static std::vector<size_t> size_sweep(size_t min_size, size_t max_size)
+{
+    std::vector<size_t> sizes;
+    for (size_t n = min_size; n < max_size; n *= 4)
+        sizes.push_back(n);
+    sizes.push_back(max_size);
+    return sizes;
+}
+
+static bool selected(const MicroBench& bench, const std::vector<std::string>& filter)
+{
+    if (filter.empty())
+        return true;
+    for (size_t i = 0; i < filter.size(); i++)
+    {
+        if (strstr(bench.name, filter[i].c_str()) != nullptr)
+            return true;
+    }
+    return false;
+}
+
+static double now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// 先调用一次预热并估计单次用时，据此决定每批的调用次数，然后逐批采样（每次调用的平均用时）
+static void measure(const MicroBench& bench, const float data[], int n, double min_time_ms, std::vector<double>& samples)
+{
+    const double start = now_ms();
+    bench.run(data, n);
+    const double once = now_ms() - start;
+    const long batch = (once >= MICRO_MIN_BATCH_MS) ? 1 : std::min(1L << 20, (long)(MICRO_MIN_BATCH_MS / std::max(once, 1e-6)) + 1);
+
+    double total = 0.0;
+    while ((total < min_time_ms || samples.size() < MICRO_MIN_SAMPLES) && samples.size() < MICRO_MAX_SAMPLES)
+    {
+        const double begin = now_ms();
+        for (long i = 0; i < batch; i++)
+            bench.run(data, n);
+        const double elapsed = now_ms() - begin;
+        samples.push_back(elapsed / batch);
+        total += elapsed;
+    }
+}
+
+static const MicroResult* find_result(const std::vector<MicroResult>& results, int bench, size_t size, int threads)
+{
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        if (results[i].bench == bench && results[i].size == size && results[i].threads == threads)
+            return &results[i];
+    }
+    return nullptr;
+}
+
+// 每个 SpeedUp 操作、每个规模一行：各线程数的吞吐量与相对 1 线程的加速比，
+// 扩展停止于线程数继续增加而吞吐量提升不足 10% 的位置；有 Basic 结果时给出最佳吞吐量相对 Basic 的倍数
+// （g_microBenches 中每个 SpeedUp 操作紧跟在对应的 Basic 操作之后）
+static void print_scaling(const std::vector<MicroResult>& results, const std::vector<size_t>& sizes,
+                          const std::vector<int>& threads)
+{
+    printf("\n[Scaling] 中位数吞吐量 Melem/s（括号内为相对 %d 线程的加速比）\n", threads[0]);
+    for (int b = 0; b < g_microBenchCount; b++)
+    {
+        const MicroBench& bench = g_microBenches[b];
+        if (!bench.parallel)
+            continue;
+        for (size_t s = 0; s < sizes.size(); s++)
+        {
+            const MicroResult* first = find_result(results, b, sizes[s], threads[0]);
+            if (first == nullptr)
+                continue;
+
+            printf("%-12s %10zu:", bench.name, sizes[s]);
+            const MicroResult* best = first;
+            int stop = 0;
+            for (size_t t = 0; t < threads.size(); t++)
+            {
+                const MicroResult* r = find_result(results, b, sizes[s], threads[t]);
+                printf("  %d线程 %.1f (%.2fx)", threads[t], r->melems, r->melems / first->melems);
+                if (r->melems > best->melems)
+                    best = r;
+                const MicroResult* next = (t + 1 < threads.size()) ? find_result(results, b, sizes[s], threads[t + 1]) : nullptr;
+                if (stop == 0 && (next == nullptr || next->melems < r->melems * MICRO_SCALING_GAIN))
+                    stop = threads[t];
+            }
+            printf("  | 扩展停止于 %d 线程，效率 %.0f%%", stop,
+                   100.0 * best->melems / (first->melems * best->threads / threads[0]));
+            const MicroResult* basic = find_result(results, b - 1, sizes[s], 1);
+            if (basic != nullptr && basic->melems > 0.0)
+                printf("，相对 %s %.1fx", g_microBenches[b - 1].name, best->melems / basic->melems);
+            printf("\n");
+        }
+    }
+}
+
+// 读取 CSV 报告中的 operation 与 melem_per_s 两列
+static bool load_baseline(const char* path, std::map<std::string, double>& baseline)
+{
+    FILE* f = fopen(path, "r");
+    if (f == nullptr)
+    {
+        printf("[Micro] 无法读取基线 %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    char line[4096];
+    int name_col = -1, value_col = -1;
+    while (fgets(line, sizeof(line), f) != nullptr)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        const std::vector<std::string> cols = split_list(line);
+        if (name_col < 0)
+        {
+            for (size_t c = 0; c < cols.size(); c++)
+            {
+                if (cols[c] == "operation")
+                    name_col = (int)c;
+                else if (cols[c] == "melem_per_s")
+                    value_col = (int)c;
+            }
+            if (name_col < 0 || value_col < 0)
+                break;
+            continue;
+        }
+        if ((int)cols.size() > std::max(name_col, value_col))
+            baseline[cols[name_col]] = atof(cols[value_col].c_str());
+    }
+    fclose(f);
+
+    if (name_col < 0 || value_col < 0)
+    {
+        printf("[Micro] 基线 %s 不是 --format csv 的报告（缺少 operation 或 melem_per_s 列）\n", path);
+        return false;
+    }
+    return true;
+}
+
+// 返回下降超过容差的项数
+static int compare_baseline(const std::map<std::string, double>& baseline, const std::vector<BenchSeries>& series,
+                            double tolerance)
+{
+    int regressions = 0, compared = 0;
+    printf("\n[Baseline] 允许下降 %.1f%%\n", tolerance);
+    for (size_t i = 0; i < series.size(); i++)
+    {
+        std::map<std::string, double>::const_iterator it = baseline.find(series[i].name);
+        if (it == baseline.end() || it->second <= 0.0)
+            continue;
+        const BenchStats st = bench_stats(series[i].ms);
+        const double current = (st.median_ms > 0.0) ? series[i].elements / (st.median_ms * 1e3) : 0.0;
+        const double change = 100.0 * (current - it->second) / it->second;
+        const bool regressed = change < -tolerance;
+        printf("%-36s %12.1f -> %12.1f Melem/s  %+7.1f%%%s\n", series[i].name.c_str(), it->second, current, change,
+               regressed ? "  <-- 回归" : "");
+        compared++;
+        if (regressed)
+            regressions++;
+    }
+    printf("[Baseline] 比较了 %d 项，%d 项回归\n", compared, regressions);
+    return regressions;
+}
+
+int main(int argc, char* argv[])
+{
+    enum
+    {
+        OPT_FILTER = 256,
+        OPT_MIN_SIZE,
+        OPT_MAX_SIZE,
+        OPT_THREADS,
+        OPT_MIN_TIME,
+        OPT_FORMAT,
+        OPT_OUTPUT,
+        OPT_BASELINE,
+        OPT_TOLERANCE,
+        OPT_ISA,
+        OPT_SORT
+    };
+    static const struct option long_options[] = {
+        {"filter", required_argument, nullptr, OPT_FILTER},
+        {"min-size", required_argument, nullptr, OPT_MIN_SIZE},
+        {"max-size", required_argument, nullptr, OPT_MAX_SIZE},
+        {"threads", required_argument, nullptr, OPT_THREADS},
+        {"min-time", required_argument, nullptr, OPT_MIN_TIME},
+        {"format", required_argument, nullptr, OPT_FORMAT},
+        {"output", required_argument, nullptr, OPT_OUTPUT},
+        {"baseline", required_argument, nullptr, OPT_BASELINE},
+        {"tolerance", required_argument, nullptr, OPT_TOLERANCE},
+        {"isa", required_argument, nullptr, OPT_ISA},
+        {"sort", required_argument, nullptr, OPT_SORT},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    std::vector<std::string> filter;
+    std::vector<int> threads;
+    long long min_size = MICRO_DEFAULT_MIN_SIZE, max_size = 0, min_time = MICRO_DEFAULT_MIN_TIME_MS;
+    long long tolerance = MICRO_DEFAULT_TOLERANCE;
+    const char* baseline_path = nullptr;
+    BenchOutput output;
+    output.format = BENCH_TABLE;
+    output.path = nullptr;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+            case OPT_FILTER:
+                filter = split_list(optarg);
+                break;
+            case OPT_MIN_SIZE:
+                if ((min_size = parse_count("--min-size", optarg, INT_MAX)) <= 0) return 1;
+                break;
+            case OPT_MAX_SIZE:
+                if ((max_size = parse_count("--max-size", optarg, INT_MAX)) <= 0) return 1;
+                break;
+            case OPT_THREADS:
+                if (!parse_threads(optarg, threads)) return 1;
+                break;
+            case OPT_MIN_TIME:
+                if ((min_time = parse_count("--min-time", optarg, 3600 * 1000)) < 0) return 1;
+                break;
+            case OPT_FORMAT:
+                output.format = bench_format_from_name(optarg);
+                if (output.format < 0)
+                {
+                    printf("未知的报告格式: %s（可选 table/csv/json）\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_OUTPUT:
+                output.path = optarg;
+                break;
+            case OPT_BASELINE:
+                baseline_path = optarg;
+                break;
+            case OPT_TOLERANCE:
+                if ((tolerance = parse_count("--tolerance", optarg, 100)) < 0) return 1;
+                break;
+            case OPT_ISA:
+                setenv("PARDIST_ISA", optarg, 1);
+                break;
+            case OPT_SORT:
+                setenv("PARDIST_SORT", optarg, 1);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind < argc)
+    {
+        printf("多余的参数: %s\n", argv[optind]);
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    bool any = false;
+    for (int b = 0; b < g_microBenchCount; b++)
+        any = any || selected(g_microBenches[b], filter);
+    if (!any)
+    {
+        printf("--filter 没有匹配任何操作\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::map<std::string, double> baseline;
+    if (baseline_path != nullptr && !load_baseline(baseline_path, baseline))
+        return 1;
+
+    const size_t total = input_total();
+    const size_t largest = (max_size == 0) ? std::min<size_t>(total, INT_MAX) : (size_t)max_size;
+    if (largest > total || (size_t)min_size > largest)
+    {
+        printf("[Micro] 规模范围 [%lld, %zu] 无效（输入共 %zu 个元素）\n", min_size, largest, total);
+        return 1;
+    }
+    if (threads.empty())
+        threads = default_threads();
+    const std::vector<size_t> sizes = size_sweep((size_t)min_size, largest);
+
+    // 每个规模都取同一份数据的前 n 个元素
+    const float* data = load_partition(0, largest);
+    if (data == nullptr)
+        return 1;
+
+    printf("[Micro] %s，规模 %zu..%zu（%zu 档），线程数", input_kind_name(input_kind()), sizes.front(), sizes.back(),
+           sizes.size());
+    for (size_t t = 0; t < threads.size(); t++)
+        printf("%s%d", t ? "," : " ", threads[t]);
+    printf("，内核 %s，排序后端 %s，每项至少 %lld ms\n", speedup_kernels().name, sort_backend_name(sort_backend()), min_time);
+
+    const int saved_threads = omp_get_max_threads();
+    std::vector<BenchSeries> series;
+    std::vector<MicroResult> results;
+    for (int b = 0; b < g_microBenchCount; b++)
+    {
+        const MicroBench& bench = g_microBenches[b];
+        if (!selected(bench, filter))
+            continue;
+        for (size_t s = 0; s < sizes.size(); s++)
+        {
+            const size_t n = sizes[s];
+            for (size_t t = 0; t < threads.size(); t++)
+            {
+                // Basic 版是单线程的，只测一次
+                const int nthreads = bench.parallel ? threads[t] : 1;
+                if (!bench.parallel && t > 0)
+                    break;
+                omp_set_num_threads(nthreads);
+
+                char name[128];
+                snprintf(name, sizeof(name), "%s/%zu/threads:%d", bench.name, n, nthreads);
+                BenchSeries one;
+                one.name = name;
+                one.elements = n;
+                measure(bench, data, (int)n, (double)min_time, one.ms);
+
+                const BenchStats st = bench_stats(one.ms);
+                MicroResult r;
+                r.bench = b;
+                r.size = n;
+                r.threads = nthreads;
+                r.melems = (st.median_ms > 0.0) ? n / (st.median_ms * 1e3) : 0.0;
+                printf("[Micro] %-36s 中位数 %12.6f ms %10.1f Melem/s %10.1f MB/s\n", name, st.median_ms, r.melems,
+                       r.melems * sizeof(float));
+                results.push_back(r);
+                series.push_back(one);
+            }
+        }
+    }
+    omp_set_num_threads(saved_threads);
+
+    print_scaling(results, sizes, threads);
+
+    char procs[16];
+    snprintf(procs, sizeof(procs), "%d", omp_get_num_procs());
+    BenchContext context;
+    context.push_back(std::make_pair(std::string("mode"), std::string("micro")));
+    context.push_back(std::make_pair(std::string("isa"), std::string(speedup_kernels().name)));
+    context.push_back(std::make_pair(std::string("sort"), std::string(sort_backend_name(sort_backend()))));
+    context.push_back(std::make_pair(std::string("procs"), std::string(procs)));
+    context.push_back(std::make_pair(std::string("input"), std::string(input_kind_name(input_kind()))));
+    const bool ok = bench_write_report(output, context, series);
+
+    int regressions = 0;
+    if (baseline_path != nullptr)
+        regressions = compare_baseline(baseline, series, (double)tolerance);
+
+    arena_release_all();
+    input_release();
+    if (!ok)
+        return 1;
+    return regressions > 0 ? 2 : 0;
+}
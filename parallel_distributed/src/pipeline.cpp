@@ -0,0 +1,83 @@
+/*
+    流水线执行器：本节点一轮计算的数据准备与单趟扫描
+    数据按 SHUFFLE_BLOCK（64K 元素，256 KB，可放进 L2）分块，每块依次
+    生成或读入 → 融合 Sum/Max → 计算排序键 →（键就地排序时）排序的成段阶段，都在这一块留在缓存中时完成，
+    原来对整段数据的三趟内存扫描（生成、Sum/Max、键变换）合为一趟，基数排序的第一趟统计
+    （或归并排序的段内排序）也不再单独扫描
+    各线程按 static 划分处理不同的块：有的线程还在生成或读入时其他线程已经在计算，
+    不需要等全部数据就绪，也不再需要固定的等待
+*/
+
+#include "common.hpp"
+#include "input.hpp"
+#include "kernels.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+bool run_local_pipeline(size_t start, size_t count, int sum_mode, float keys[], const SortRuns* runs,
+                        LocalResult* result)
+{
+    TRACE_SCOPE("pipeline", count);
+    const float* data = input_prepare(start, count);
+    if (data == nullptr)
+        return false;
+
+    const KernelTable& kernels = speedup_kernels();
+    const long long blocks = (long long)((count + SHUFFLE_BLOCK - 1) / SHUFFLE_BLOCK);
+    float sum = 0.0f;
+    SumFixed fixed = 0;
+    float max = -std::numeric_limits<float>::infinity();
+    bool ok = true;
+
+    // 每块由一个线程处理；内核自身的 parallel 区域嵌套在这里时不再展开（默认不启用嵌套并行）
+    #pragma omp parallel for schedule(static) reduction(+:sum, fixed) reduction(max:max) reduction(&&:ok)
+    for (long long b = 0; b < blocks; ++b)
+    {
+        const size_t offset = (size_t)b * SHUFFLE_BLOCK;
+        const int n = (int)std::min<size_t>(SHUFFLE_BLOCK, count - offset);
+        {
+            TRACE_SCOPE("load_block", n);
+            ok = input_fill_block(offset, n) && ok;
+        }
+
+        float block_max;
+        if (sum_mode == SUM_EXACT)
+        {
+            TRACE_SCOPE("sum_max_exact", n);
+            SumFixed block_fixed;
+            kernels.sum_max_exact(data + offset, n, &block_fixed, &block_max);
+            fixed += block_fixed;
+        }
+        else
+        {
+            TRACE_SCOPE("sum_max", n);
+            float block_sum;
+            kernels.sum_max(data + offset, n, &block_sum, &block_max);
+            sum += block_sum;
+        }
+        max = std::max(max, block_max);
+
+        {
+            TRACE_SCOPE("keys", n);
+            kernels.log_keys(data + offset, n, keys + offset);
+        }
+        if (runs != nullptr)
+        {
+            TRACE_SCOPE("sort_runs", n);
+            sort_runs_block(*runs, offset, n);
+        }
+    }
+
+    if (!ok)
+    {
+        printf("[Pipeline] 加载全局下标 [%zu, %zu) 的数据失败\n", start, start + count);
+        return false;
+    }
+    result->sum = (sum_mode == SUM_EXACT) ? (float)sum_fixed_to_double(fixed) : sum;
+    result->fixed = fixed;
+    result->max = max;
+    return true;
+}
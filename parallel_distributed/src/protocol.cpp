@@ -0,0 +1,57 @@
+/*
+    控制消息的编码与解码
+*/
+
+#include "protocol.hpp"
+
+#include <cstring>
+#include <atomic>
+
+static std::atomic<uint32_t> g_messageSeq(0);
+
+size_t encode_message(char* buffer, uint8_t type, int32_t round, const void* payload, uint32_t length)
+{
+    MessageHeader header;
+    header.magic = PROTOCOL_MAGIC;
+    header.version = PROTOCOL_VERSION;
+    header.type = type;
+    header.round = round;
+    header.seq = ++g_messageSeq;
+    header.length = length;
+
+    memcpy(buffer, &header, sizeof(header));
+    if (length > 0)
+    {
+        memcpy(buffer + sizeof(header), payload, length);
+    }
+    return sizeof(header) + length;
+}
+
+bool decode_message(const char* buffer, size_t len, MessageHeader* header, const char** payload)
+{
+    if (len < sizeof(MessageHeader))
+    {
+        return false;
+    }
+    memcpy(header, buffer, sizeof(MessageHeader));
+    if (header->magic != PROTOCOL_MAGIC || header->version != PROTOCOL_VERSION)
+    {
+        return false;
+    }
+    if (sizeof(MessageHeader) + header->length > len)
+    {
+        return false;
+    }
+    *payload = buffer + sizeof(MessageHeader);
+    return true;
+}
+
+const char* message_type_name(uint8_t type)
+{
+    static const char* names[MSG_TYPE_COUNT] = {
+        "UNKNOWN", "JOIN", "ASSIGN", "RESULT_SUM", "RESULT_MAX", "RESULTS_READY",
+        "PEERS", "SAMPLES", "SPLITTERS", "EXCHANGE_OFFER", "EXCHANGE_PULL", "RANGE_SUMMARY",
+        "ABORT"
+    };
+    return (type < MSG_TYPE_COUNT) ? names[type] : "UNKNOWN";
+}
@@ -0,0 +1,203 @@
+/*
+    并行 LSD 基数排序（float 键）
+    float 的位模式经过变换后按无符号整数比较即与浮点大小顺序一致：
+    正数翻转符号位，负数按位取反
+    每趟处理 RADIX_BITS 位：各线程统计自己连续数据段的直方图，
+    按（桶, 线程）顺序做前缀和得到写入位置，再各自稳定地分发到目标数组
+    元素可以只是键（4 字节），也可以是键-下标对（8 字节，argsort），两者共用同一份模板实现
+    第一趟的直方图也可以由调用者按块预先统计（流水线在键仍在缓存中时完成，见 radixBlockHistogram），
+    这时各线程的数据段按块对齐，第一趟不再扫描数据
+*/
+
+#include "common.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+#include <omp.h>
+
+#define RADIX_PASSES ((32 + RADIX_BITS - 1) / RADIX_BITS)   // 11 + 11 + 10 位，共 3 趟
+
+// 键数组按 uint32 位模式读写，声明 may_alias 以免与 float 访问违反严格别名规则
+// （属性放在结构体上，作为模板参数时不会被丢掉）
+struct __attribute__((__may_alias__)) radix_word
+{
+    uint32_t key;
+};
+
+// 与 KeyIndex 布局相同
+struct __attribute__((__may_alias__)) radix_pair
+{
+    uint32_t key;
+    uint32_t index;
+};
+
+// 换上新的键位模式，下标原样带走
+template <typename Elem>
+static inline Elem with_key(Elem e, uint32_t key)
+{
+    e.key = key;
+    return e;
+}
+
+static inline uint32_t float_to_radix(uint32_t u)
+{
+    return u ^ ((uint32_t)((int32_t)u >> 31) | 0x80000000u);
+}
+
+static inline uint32_t radix_to_float(uint32_t u)
+{
+    return u ^ (((u >> 31) - 1) | 0x80000000u);
+}
+
+// 第一趟直接读原始 float 位模式，读入时再做变换，省去一次单独的变换遍历
+static inline uint32_t radix_key(uint32_t u, bool mapped)
+{
+    return mapped ? u : float_to_radix(u);
+}
+
+// 对 keys[0, n) 按键升序稳定排序，temp 为同样大小的辅助数组，结果写回 keys
+// block_hist 不为空时为每 block 个元素一块的第一趟直方图（block_hist[b * RADIX_BUCKETS + d]）
+template <typename Elem>
+static void radix_sort(Elem keys[], size_t n, Elem temp[], const uint32_t* block_hist = nullptr, size_t block = 0)
+{
+    if (n < 2)
+    {
+        return;
+    }
+
+    const int max_threads = omp_get_max_threads();
+    size_t* hist = new size_t[(size_t)max_threads * RADIX_BUCKETS];
+    bool skip = false;     // 本趟所有键的数字相同，无需分发（各线程共享）
+
+    #pragma omp parallel
+    {
+        Elem* src = keys;
+        Elem* dst = temp;
+        bool mapped = false;   // src 中是否已经是变换后的键
+        const int tid = omp_get_thread_num();
+        const int nthreads = omp_get_num_threads();
+        size_t begin = n * tid / nthreads;
+        size_t end = n * (tid + 1) / nthreads;
+        if (block_hist != nullptr)
+        {
+            // 按块对齐，第一趟的直方图由本线程的各块相加得到
+            const size_t blocks = (n + block - 1) / block;
+            begin = std::min(n, blocks * tid / nthreads * block);
+            end = std::min(n, blocks * (tid + 1) / nthreads * block);
+        }
+        size_t* h = hist + (size_t)tid * RADIX_BUCKETS;
+
+        for (int pass = 0; pass < RADIX_PASSES; pass++)
+        {
+            const int shift = pass * RADIX_BITS;
+
+            // 1. 统计本线程数据段的直方图
+            if (pass == 0 && block_hist != nullptr)
+            {
+                memset(h, 0, RADIX_BUCKETS * sizeof(size_t));
+                for (size_t b = begin / block; b * block < end; b++)
+                {
+                    for (int d = 0; d < RADIX_BUCKETS; d++)
+                        h[d] += block_hist[b * RADIX_BUCKETS + d];
+                }
+            }
+            else
+            {
+                TRACE_SCOPE("radix_histogram", pass);
+                memset(h, 0, RADIX_BUCKETS * sizeof(size_t));
+                for (size_t i = begin; i < end; i++)
+                {
+                    h[(radix_key(src[i].key, mapped) >> shift) & (RADIX_BUCKETS - 1)]++;
+                }
+            }
+
+            #pragma omp barrier
+
+            // 2. 按（桶, 线程）顺序求前缀和，h[d] 变为本线程桶 d 的起始写入位置
+            #pragma omp single
+            {
+                size_t offset = 0;
+                skip = false;
+                for (int d = 0; d < RADIX_BUCKETS; d++)
+                {
+                    size_t bucket_total = 0;
+                    for (int t = 0; t < nthreads; t++)
+                    {
+                        size_t count = hist[(size_t)t * RADIX_BUCKETS + d];
+                        hist[(size_t)t * RADIX_BUCKETS + d] = offset;
+                        offset += count;
+                        bucket_total += count;
+                    }
+                    if (bucket_total == n)
+                    {
+                        skip = true;
+                    }
+                }
+            }
+
+            // single 结尾的隐式屏障保证所有线程看到相同的 skip；
+            // 下一趟的 single 在直方图之后的屏障之后才会改写它
+            if (skip)
+            {
+                continue;
+            }
+
+            // 3. 稳定分发：同一桶内保持线程顺序和段内顺序
+            {
+                TRACE_SCOPE("radix_scatter", pass);
+                for (size_t i = begin; i < end; i++)
+                {
+                    uint32_t key = radix_key(src[i].key, mapped);
+                    dst[h[(key >> shift) & (RADIX_BUCKETS - 1)]++] = with_key(src[i], key);
+                }
+            }
+
+            #pragma omp barrier
+
+            Elem* swap = src;
+            src = dst;
+            dst = swap;
+            mapped = true;
+        }
+
+        // 还原 float 位模式，结果写回 keys
+        if (mapped)
+        {
+            #pragma omp for schedule(static)
+            for (size_t i = 0; i < n; i++)
+            {
+                keys[i] = with_key(src[i], radix_to_float(src[i].key));
+            }
+        }
+    }
+
+    delete[] hist;
+}
+
+void radixSortKeys(float keys[], size_t n, float temp[])
+{
+    radix_sort((radix_word*)keys, n, (radix_word*)temp);
+}
+
+void radixBlockHistogram(const float keys[], size_t n, uint32_t hist[])
+{
+    const radix_word* words = (const radix_word*)keys;
+    memset(hist, 0, RADIX_BUCKETS * sizeof(uint32_t));
+    for (size_t i = 0; i < n; i++)
+    {
+        hist[float_to_radix(words[i].key) & (RADIX_BUCKETS - 1)]++;
+    }
+}
+
+void radixSortKeysBlocked(float keys[], size_t n, float temp[], const uint32_t block_hist[], size_t block)
+{
+    radix_sort((radix_word*)keys, n, (radix_word*)temp, block_hist, block);
+}
+
+void radixSortPairs(KeyIndex pairs[], size_t n, KeyIndex temp[])
+{
+    static_assert(sizeof(KeyIndex) == sizeof(radix_pair), "KeyIndex layout");
+    radix_sort((radix_pair*)pairs, n, (radix_pair*)temp);
+}
@@ -0,0 +1,100 @@
+/*
+    分布式样本排序的本地计算部分：取样、选分割点、按分割点分桶
+    节点间的样本汇总和数据交换在 UDP.cpp 中完成
+*/
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <omp.h>
+
+// 从 n 个键中等间隔取 count 个样本（数据已打乱，等间隔取样即随机取样），返回实际个数
+size_t pick_samples(const float keys[], size_t n, float samples[], size_t count)
+{
+    if (n < count)
+    {
+        count = n;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        samples[i] = keys[(size_t)((i + 0.5) * n / count)];
+    }
+    return count;
+}
+
+// 汇总的样本排序后，按各节点的权重（期望处理的数据比例）取出 parts - 1 个分割点
+// 第 j 个节点负责 [splitters[j-1], splitters[j]) 内的键
+void choose_splitters(float samples[], size_t count, const double weights[], int parts, float splitters[])
+{
+    std::sort(samples, samples + count);
+
+    double weight_sum = 0.0;
+    for (int j = 0; j < parts; j++)
+    {
+        weight_sum += weights[j];
+    }
+
+    double cumulative = 0.0;
+    for (int j = 0; j + 1 < parts; j++)
+    {
+        cumulative += weights[j];
+        size_t pos = (size_t)(cumulative / weight_sum * count);
+        splitters[j] = (count == 0) ? 0.0f : samples[std::min(pos, count - 1)];
+    }
+}
+
+// 键所属的桶：不大于它的分割点个数（与分割点相等的键归入右侧的桶）
+static inline int bucket_of(float key, const float splitters[], int parts)
+{
+    return (int)(std::upper_bound(splitters, splitters + parts - 1, key) - splitters);
+}
+
+// 按分割点把 keys 分成 parts 个桶，依次连续写入 out，counts[j] 为第 j 个桶的元素个数
+// 与基数排序的一趟相同：各线程统计自己数据段的直方图，按（桶, 线程）求前缀和后分发
+void partition_by_splitters(const float keys[], size_t n, const float splitters[], int parts,
+                            float out[], size_t counts[])
+{
+    const int max_threads = omp_get_max_threads();
+    size_t* hist = new size_t[(size_t)max_threads * parts];
+
+    #pragma omp parallel
+    {
+        const int tid = omp_get_thread_num();
+        const int nthreads = omp_get_num_threads();
+        const size_t begin = n * tid / nthreads;
+        const size_t end = n * (tid + 1) / nthreads;
+        size_t* h = hist + (size_t)tid * parts;
+
+        memset(h, 0, parts * sizeof(size_t));
+        for (size_t i = begin; i < end; i++)
+        {
+            h[bucket_of(keys[i], splitters, parts)]++;
+        }
+
+        #pragma omp barrier
+
+        #pragma omp single
+        {
+            size_t offset = 0;
+            for (int j = 0; j < parts; j++)
+            {
+                counts[j] = 0;
+                for (int t = 0; t < nthreads; t++)
+                {
+                    size_t count = hist[(size_t)t * parts + j];
+                    hist[(size_t)t * parts + j] = offset;
+                    offset += count;
+                    counts[j] += count;
+                }
+            }
+        }
+
+        for (size_t i = begin; i < end; i++)
+        {
+            out[h[bucket_of(keys[i], splitters, parts)]++] = keys[i];
+        }
+    }
+
+    delete[] hist;
+}
@@ -0,0 +1,278 @@
+/*
+    任务窃取调度器：每个工作线程一个 Chase–Lev 双端队列，见 scheduler.hpp
+    队列按 Lê 等人 "Correct and Efficient Work-Stealing for Weak Memory Models"（PPoPP 2013）的 C11 版本实现，
+    容量固定（WS_DEQUE_CAPACITY），满时 ws_spawn 直接执行任务，因此不需要扩容
+*/
+
+#include "scheduler.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sched.h>
+#include <stdint.h>
+#include <x86intrin.h>
+#include <omp.h>
+
+// 每个队列独占缓存行，top 由窃取者修改、bottom 由所有者修改，两者也分开
+struct alignas(64) WsDeque
+{
+    std::atomic<int64_t> top;
+    char pad0[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t> bottom;
+    char pad1[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<WsTask*> buffer[WS_DEQUE_CAPACITY];
+};
+
+struct WsPool
+{
+    WsDeque* deques;
+    int workers;
+    std::atomic<bool> done;
+};
+
+// 当前线程所在的调度器与线程号；嵌套的 ws_run 保存并恢复外层的值
+static thread_local WsPool* t_pool = nullptr;
+static thread_local int t_worker = 0;
+static thread_local uint64_t t_random = 0;
+
+static bool deque_push(WsDeque* q, WsTask* task)
+{
+    const int64_t b = q->bottom.load(std::memory_order_relaxed);
+    const int64_t t = q->top.load(std::memory_order_acquire);
+    if (b - t >= WS_DEQUE_CAPACITY)
+        return false;
+    q->buffer[b & (WS_DEQUE_CAPACITY - 1)].store(task, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    q->bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+// 所有者从底部弹出；只剩一个任务时与窃取者竞争 top
+static WsTask* deque_pop(WsDeque* q)
+{
+    const int64_t b = q->bottom.load(std::memory_order_relaxed) - 1;
+    q->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = q->top.load(std::memory_order_relaxed);
+    if (t > b)
+    {
+        q->bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    WsTask* task = q->buffer[b & (WS_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (t == b)
+    {
+        if (!q->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            task = nullptr;
+        q->bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+// 窃取者从顶部取；竞争失败与队列为空一样返回 nullptr，由调用者换一个目标重试
+static WsTask* deque_steal(WsDeque* q)
+{
+    int64_t t = q->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = q->bottom.load(std::memory_order_acquire);
+    if (t >= b)
+        return nullptr;
+
+    WsTask* task = q->buffer[t & (WS_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!q->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+    return task;
+}
+
+static void execute(WsTask* task)
+{
+    task->run(task->arg);
+    task->group->pending.fetch_sub(1, std::memory_order_release);
+}
+
+// xorshift64，选择窃取目标
+static uint64_t next_random()
+{
+    t_random ^= t_random << 13;
+    t_random ^= t_random >> 7;
+    t_random ^= t_random << 17;
+    return t_random;
+}
+
+// 先看自己的队列，再从随机位置开始依次尝试其他线程
+static WsTask* find_task(WsPool* pool)
+{
+    WsTask* task = deque_pop(&pool->deques[t_worker]);
+    if (task != nullptr || pool->workers == 1)
+        return task;
+
+    const int start = (int)(next_random() % (uint64_t)pool->workers);
+    for (int k = 0; k < pool->workers; k++)
+    {
+        const int victim = (start + k) % pool->workers;
+        if (victim == t_worker)
+            continue;
+        task = deque_steal(&pool->deques[victim]);
+        if (task != nullptr)
+            return task;
+    }
+    return nullptr;
+}
+
+// 找不到任务时先 pause 自旋，连续失败较多次后让出 CPU（线程数超过核心数时不空转占满时间片）
+static void idle(int* failures)
+{
+    if (++*failures < 64)
+    {
+        _mm_pause();
+    }
+    else
+    {
+        sched_yield();
+        *failures = 0;
+    }
+}
+
+void ws_group_init(WsGroup* group)
+{
+    group->pending.store(0, std::memory_order_relaxed);
+}
+
+void ws_spawn(WsGroup* group, WsTask* task, void (*run)(void* arg), void* arg)
+{
+    task->run = run;
+    task->arg = arg;
+    task->group = group;
+    group->pending.fetch_add(1, std::memory_order_relaxed);
+
+    WsPool* pool = t_pool;
+    if (pool == nullptr || pool->workers == 1 || !deque_push(&pool->deques[t_worker], task))
+        execute(task);
+}
+
+void ws_wait(WsGroup* group)
+{
+    WsPool* pool = t_pool;
+    int failures = 0;
+    while (group->pending.load(std::memory_order_acquire) > 0)
+    {
+        WsTask* task = (pool != nullptr) ? find_task(pool) : nullptr;
+        if (task != nullptr)
+        {
+            execute(task);
+            failures = 0;
+        }
+        else
+        {
+            idle(&failures);
+        }
+    }
+}
+
+void ws_run(void (*root)(void* arg), void* arg)
+{
+    WsPool* outer_pool = t_pool;
+    const int outer_worker = t_worker;
+
+    WsPool pool;
+    pool.workers = omp_in_parallel() ? 1 : omp_get_max_threads();
+    // C++11 的 new 不保证超过 16 字节的对齐，按缓存行对齐分配；分配失败时在当前线程上串行执行
+    void* memory = nullptr;
+    if (posix_memalign(&memory, 64, sizeof(WsDeque) * pool.workers) != 0)
+    {
+        printf("[Sched] 无法分配 %d 个任务队列，串行执行\n", pool.workers);
+        root(arg);
+        return;
+    }
+    pool.deques = (WsDeque*)memory;
+    for (int i = 0; i < pool.workers; i++)
+    {
+        new (&pool.deques[i]) WsDeque;
+        pool.deques[i].top.store(0, std::memory_order_relaxed);
+        pool.deques[i].bottom.store(0, std::memory_order_relaxed);
+    }
+    pool.done.store(false, std::memory_order_relaxed);
+
+    #pragma omp parallel num_threads(pool.workers)
+    {
+        WsPool* saved_pool = t_pool;
+        const int saved_worker = t_worker;
+        t_pool = &pool;
+        t_worker = omp_get_thread_num();
+        if (t_random == 0)
+            t_random = 0x9E3779B97F4A7C15ull * (uint64_t)(t_worker + 1);
+
+        if (t_worker == 0)
+        {
+            root(arg);
+            pool.done.store(true, std::memory_order_release);
+        }
+        else
+        {
+            int failures = 0;
+            while (!pool.done.load(std::memory_order_acquire))
+            {
+                WsTask* task = find_task(&pool);
+                if (task != nullptr)
+                {
+                    execute(task);
+                    failures = 0;
+                }
+                else
+                {
+                    idle(&failures);
+                }
+            }
+        }
+        t_pool = saved_pool;
+        t_worker = saved_worker;
+    }
+
+    free(pool.deques);
+    t_pool = outer_pool;
+    t_worker = outer_worker;
+}
+
+int ws_workers()
+{
+    return (t_pool != nullptr) ? t_pool->workers : 1;
+}
+
+struct WsForRange
+{
+    void (*body)(void* arg, size_t i);
+    void* arg;
+    size_t begin;
+    size_t end;
+};
+
+// 每次把后一半作为任务压入、自己继续拆前一半，空闲线程窃取到的总是尚未拆分的大块
+static void for_range(void* p)
+{
+    const WsForRange* range = (const WsForRange*)p;
+    if (range->end - range->begin == 1)
+    {
+        range->body(range->arg, range->begin);
+        return;
+    }
+
+    const size_t mid = range->begin + (range->end - range->begin) / 2;
+    WsForRange right = {range->body, range->arg, mid, range->end};
+    WsForRange left = {range->body, range->arg, range->begin, mid};
+    WsGroup group;
+    WsTask task;
+    ws_group_init(&group);
+    ws_spawn(&group, &task, for_range, &right);
+    for_range(&left);
+    ws_wait(&group);
+}
+
+void ws_for(size_t count, void (*body)(void* arg, size_t i), void* arg)
+{
+    if (count == 0)
+        return;
+    WsForRange all = {body, arg, 0, count};
+    for_range(&all);
+}
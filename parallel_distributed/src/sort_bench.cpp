@@ -0,0 +1,162 @@
+/*
+    排序后端基准测试：在各节点实际处理的数据规模下比较归并排序与基数排序，
+    以及带 uint32 下标的 argsort（键-下标对基数排序）
+    另外对 transforms.hpp 中的每种变换比较基础版本与加速版本的 Sum/Max + 排序
+*/
+
+#include "common.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <time.h>
+#include <omp.h>
+
+#define SORT_BENCH_REPEAT 3
+
+static double elapsed_ms(const struct timespec& start, const struct timespec& end)
+{
+    return (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+// 取 SORT_BENCH_REPEAT 次中的最短用时
+static double time_sort(int backend, size_t size, float* result)
+{
+    double best = 0.0;
+    for (int r = 0; r < SORT_BENCH_REPEAT; r++)
+    {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        sortSpeedUpWith(backend, rawFloatData, size, result);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double ms = elapsed_ms(start, end);
+        if (r == 0 || ms < best)
+            best = ms;
+    }
+    return best;
+}
+
+static double time_argsort(size_t size, KeyIndex* result)
+{
+    double best = 0.0;
+    for (int r = 0; r < SORT_BENCH_REPEAT; r++)
+    {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        argsortSpeedUp(rawFloatData, size, result);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double ms = elapsed_ms(start, end);
+        if (r == 0 || ms < best)
+            best = ms;
+    }
+    return best;
+}
+
+// argsort 的键与排序结果一致，且每个下标处的原始数据变换后正是对应的键
+static bool argsort_matches(const KeyIndex* pairs, const float* sorted, size_t size, float* scratch)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        if (pairs[i].key != sorted[i] || pairs[i].index >= size)
+            return false;
+        scratch[i] = rawFloatData[pairs[i].index];
+    }
+    computeSortKeys(scratch, size, scratch);
+    return memcmp(scratch, sorted, size * sizeof(float)) == 0;
+}
+
+// 两个有序结果逐项比较的最大相对误差（加速版本的向量 log 与 libm 相差不超过 1 ULP，sqrt 与乘法完全一致）
+static double max_relative_error(const float* a, const float* b, size_t size)
+{
+    double worst = 0.0;
+    for (size_t i = 0; i < size; i++)
+    {
+        double diff = std::fabs((double)a[i] - (double)b[i]);
+        double scale = std::fmax(std::fabs((double)b[i]), 1e-30);
+        worst = std::fmax(worst, diff / scale);
+    }
+    return worst;
+}
+
+// 一种变换：基础版本（逐元素 libm，单调变换排序时比较原始数据）与加速版本各做一次 Sum/Max + 排序
+template <typename Transform>
+static void bench_transform(int transform, size_t size, float* basic_sorted, float* fast_sorted)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    float basic_sum = sumBasicWith<Transform>(rawFloatData, size);
+    float basic_max = maxBasicWith<Transform>(rawFloatData, size);
+    sortBasicWith<Transform>(rawFloatData, size, basic_sorted);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double basic_ms = elapsed_ms(start, end);
+
+    double fast_ms = 0.0;
+    float fast_sum = 0.0f, fast_max = 0.0f;
+    for (int r = 0; r < SORT_BENCH_REPEAT; r++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        sumMaxTransformed(transform, rawFloatData, size, &fast_sum, &fast_max);
+        sortTransformed(transform, rawFloatData, size, fast_sorted);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double ms = elapsed_ms(start, end);
+        if (r == 0 || ms < fast_ms)
+            fast_ms = ms;
+    }
+
+    printf("%10s %6s %12.2f %12.2f %7.2fx %14.3e %14.3e %10.2e\n", transform_name(transform),
+           transform_monotonic(transform) ? "是" : "否", basic_ms, fast_ms, basic_ms / fast_ms,
+           (double)basic_sum, (double)fast_sum, max_relative_error(fast_sorted, basic_sorted, size));
+    (void)basic_max;
+}
+
+static void run_transform_benchmark(float* basic_sorted, float* fast_sorted)
+{
+    const size_t size = CALIBRATION_SAMPLE < DATANUM ? CALIBRATION_SAMPLE : DATANUM;
+    init_rawData(0, size);
+    shuffle_rawData(size);
+
+    printf("\n[Transform Benchmark] %zu 个元素，Sum/Max + 排序；加速版本取 %d 次中的最短用时\n", size,
+           SORT_BENCH_REPEAT);
+    printf("%10s %6s %12s %12s %8s %14s %14s %10s\n", "变换", "单调", "basic(ms)", "speedup(ms)", "加速比",
+           "basic sum", "speedup sum", "排序误差");
+    bench_transform<LogSqrtTransform>(TRANSFORM_LOG_SQRT, size, basic_sorted, fast_sorted);
+    bench_transform<SqrtTransform>(TRANSFORM_SQRT, size, basic_sorted, fast_sorted);
+    bench_transform<SquareTransform>(TRANSFORM_SQUARE, size, basic_sorted, fast_sorted);
+}
+
+void run_sort_benchmark()
+{
+    // 标定样本、1/8 ~ 1/2 的数据（有 1~7 个 Worker 时每个节点的分段）以及全部数据
+    const size_t sizes[] = {CALIBRATION_SAMPLE, DATANUM / 8, DATANUM / 4, DATANUM / 2, DATANUM};
+    const int count = sizeof(sizes) / sizeof(sizes[0]);
+
+    float* merge_result = new float[DATANUM];
+    float* radix_result = new float[DATANUM];
+    KeyIndex* argsort_result = new KeyIndex[DATANUM];
+
+    printf("\n[Sort Benchmark] %d 线程，每项取 %d 次中的最短用时\n", omp_get_max_threads(), SORT_BENCH_REPEAT);
+    printf("%12s %12s %12s %8s %8s %12s %8s\n", "元素个数", "merge(ms)", "radix(ms)", "加速比", "结果一致",
+           "argsort(ms)", "下标正确");
+    for (int i = 0; i < count; i++)
+    {
+        const size_t size = sizes[i];
+        if (size == 0 || (i > 0 && size == sizes[i - 1]))
+            continue;
+
+        init_rawData(0, size);
+        shuffle_rawData(size);
+        double merge_ms = time_sort(SORT_MERGE, size, merge_result);
+        double radix_ms = time_sort(SORT_RADIX, size, radix_result);
+        bool same = memcmp(merge_result, radix_result, size * sizeof(float)) == 0;
+        double argsort_ms = time_argsort(size, argsort_result);
+        bool indexed = argsort_matches(argsort_result, radix_result, size, merge_result);
+        printf("%12zu %12.2f %12.2f %7.2fx %8s %12.2f %8s\n", size, merge_ms, radix_ms, merge_ms / radix_ms,
+               same ? "是" : "否", argsort_ms, indexed ? "是" : "否");
+    }
+
+    run_transform_benchmark(merge_result, radix_result);
+
+    delete[] merge_result;
+    delete[] radix_result;
+    delete[] argsort_result;
+}
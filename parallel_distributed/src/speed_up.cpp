@@ -2,276 +2,424 @@
     加速版函数实现
 */
 #include "common.hpp"
+#include "kernels.hpp"
+#include "scheduler.hpp"
+#include "trace.hpp"
 
 #include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <cmath>
-#include <limits>
-#include <immintrin.h>  // SSE/AVX 指令集
+#include <algorithm>
 #include <omp.h>        // OpenMP
 
 
-// 加速的求和函数 - 使用 SSE + OpenMP（修复版）
+// 加速的求和函数：log(sqrt(x)) = 0.5 * log(x)，向量化 log + 向量累加器 + OpenMP
+// 具体实现按本机指令集在运行时选择，见 kernels.hpp
 float sumSpeedUp(const float data[], const int len)
 {
-    float total_sum = 0.0f;
-    
-    #pragma omp parallel reduction(+:total_sum)
+    return speedup_kernels().sum(data, len);
+}
+
+// 加速的最大值函数
+float maxSpeedUp(const float data[], const int len)
+{
+    return speedup_kernels().max(data, len);
+}
+
+// 求和与最大值融合为一趟，数据只读一遍
+void sumMaxSpeedUp(const float data[], const int len, float* sum, float* max)
+{
+    speedup_kernels().sum_max(data, len, sum, max);
+}
+
+// 定点求和（SUM_EXACT）与最大值，sum 为 log(x) 的定点和，用 sum_fixed_to_double 转换
+void sumMaxExactSpeedUp(const float data[], const int len, SumFixed* sum, float* max)
+{
+    speedup_kernels().sum_max_exact(data, len, sum, max);
+}
+
+// log(sqrt(x)) = 0.5 * log(x)：int64 转 double 舍入一次，再乘 2^-(SUM_FIXED_FRAC_BITS + 1)（精确）
+double sum_fixed_to_double(SumFixed sum)
+{
+    return std::ldexp((double)sum, -(SUM_FIXED_FRAC_BITS + 1));
+}
+
+int sum_mode_from_env()
+{
+    const char* mode = getenv("PARDIST_SUM_MODE");
+    if (mode == nullptr || strcmp(mode, "fast") == 0)
+        return SUM_FAST;
+    if (strcmp(mode, "exact") == 0)
+        return SUM_EXACT;
+    printf("[Sum] 未知的 PARDIST_SUM_MODE=%s（可选 fast/exact），使用 fast\n", mode);
+    return SUM_FAST;
+}
+
+const char* sum_mode_name(int mode)
+{
+    return (mode == SUM_EXACT) ? "exact" : "fast";
+}
+
+// 插入排序（小数组优化），直接比较预先计算好的键
+void insertionSort(float keys[], size_t left, size_t right)
+{
+    for (size_t i = left + 1; i <= right; ++i)
     {
-        const int limit4 = len & ~3; //
+        float key = keys[i];
+        size_t j = i;
 
-        // 处理4个一组的主循环
-        #pragma omp for nowait // 并行分配循环迭代
-        for (int i = 0; i < limit4; i += 4)
-        {
-            // 加载并防止非正数
-            __m128 vec_data = _mm_loadu_ps(&data[i]);
-            __m128 min_val = _mm_set1_ps(1e-37f);
-            vec_data = _mm_max_ps(vec_data, min_val);
-            
-            __m128 v = _mm_sqrt_ps(vec_data);
-            float t[4];
-            _mm_storeu_ps(t, v);
-            
-            // 直接累加到total_sum（reduction会自动处理）
-            total_sum += std::log(t[0]) + std::log(t[1]) +
-                         std::log(t[2]) + std::log(t[3]);
-        }
-        
-        // 串行处理尾部剩余元素
-        #pragma omp for nowait
-        for (int i = limit4; i < len; ++i)
+        while (j > left && keys[j-1] > key)
         {
-            total_sum += std::log(std::sqrt(data[i]));
+            keys[j] = keys[j-1];
+            --j;
         }
+        keys[j] = key;
     }
-    
-    return total_sum;
 }
 
-// 加速的最大值函数 - 使用 SSE + OpenMP（修复版）
-float maxSpeedUp(const float data[], const int len)
+// 归并排序的规模阈值（元素个数）
+static const size_t SORT_SERIAL_CUTOFF = 16384;    // 不超过时整段串行排序（键与辅助数组共 128 KB，在 L2 内）
+static const size_t MERGE_SEGMENT = 16384;         // 并行合并时每段的输出元素个数
+
+// 合并路径的协同划分（co-rank）：合并结果的前 k 个元素恰好由 a 的前 i 个与 b 的前 k - i 个组成，二分求 i
+// 相等的元素 a 在前；各段内部由合并内核排好，段与段之间按这里的划分有序
+static size_t co_rank(size_t k, const float* a, size_t na, const float* b, size_t nb)
 {
-    float global_max = -std::numeric_limits<float>::infinity();
-    
-    #pragma omp parallel reduction(max:global_max)
+    size_t lo = (k > nb) ? k - nb : 0;
+    size_t hi = std::min(k, na);
+    while (lo < hi)
     {
-        const int limit4 = len & ~3;
-        
-        #pragma omp for nowait
-        for (int i = 0; i < limit4; i += 4)
-        {
-            // 加载并防止非正数
-            __m128 vec_data = _mm_loadu_ps(&data[i]);
-            __m128 min_val = _mm_set1_ps(1e-37f);
-            vec_data = _mm_max_ps(vec_data, min_val);
-            
-            __m128 v = _mm_sqrt_ps(vec_data);
-            float temp[4];
-            _mm_storeu_ps(temp, v);
-            
-            float v0 = std::log(temp[0]);
-            float v1 = std::log(temp[1]);
-            float v2 = std::log(temp[2]);
-            float v3 = std::log(temp[3]);
-            
-            // 直接更新global_max（reduction会自动处理）
-            if (v0 > global_max) global_max = v0;
-            if (v1 > global_max) global_max = v1;
-            if (v2 > global_max) global_max = v2;
-            if (v3 > global_max) global_max = v3;
-        }
-        
-        // 串行处理尾部
-        #pragma omp for nowait
-        for (int i = limit4; i < len; ++i)
-        {
-            float value = std::log(std::sqrt(data[i]));
-            if (value > global_max)
-                global_max = value;
-        }
+        const size_t i = lo + (hi - lo) / 2;
+        if (a[i] <= b[k - i - 1])
+            lo = i + 1;     // a[i] 排在 b[k - i - 1] 之前，前 k 个里至少要取 a 的 i + 1 个
+        else
+            hi = i;
     }
-    
-    return global_max;
+    return lo;
 }
 
-// 插入排序（小数组优化）
-void insertionSort(const float data[], size_t* indices, size_t left, size_t right)
+struct MergeJob
 {
-    for (size_t i = left + 1; i <= right; ++i)
+    const float* a;
+    size_t na;
+    const float* b;
+    size_t nb;
+    float* dst;
+    size_t segments;
+};
+
+// 第 s 段输出 [k0, k1)：两端各做一次协同划分，段与段之间互不依赖
+static void merge_segment(void* p, size_t s)
+{
+    const MergeJob* job = (const MergeJob*)p;
+    const size_t m = job->na + job->nb;
+    const size_t k0 = m * s / job->segments;
+    const size_t k1 = m * (s + 1) / job->segments;
+    TRACE_SCOPE("merge_task", k1 - k0);
+
+    const size_t i0 = co_rank(k0, job->a, job->na, job->b, job->nb);
+    const size_t i1 = co_rank(k1, job->a, job->na, job->b, job->nb);
+    speedup_kernels().merge(job->a + i0, i1 - i0, job->b + (k0 - i0), (k1 - i1) - (k0 - i0), job->dst + k0);
+}
+
+// 并行合并（dst 不能与 a、b 重叠）：按合并路径把输出等分成 P 段（每段约 MERGE_SEGMENT 个元素），
+// 无论 a、b 长短如何各段工作量都相同，每段一个任务，用双调合并网络内核合并；
+// 在 ws_run 之外或只有一个工作线程时整段交给内核
+void mergeParallel(const float a[], size_t na, const float b[], size_t nb, float dst[])
+{
+    const size_t segments = (ws_workers() > 1) ? std::max<size_t>(1, (na + nb) / MERGE_SEGMENT) : 1;
+    if (segments == 1)
     {
-        size_t key = indices[i];
-        float key_value = std::log(std::sqrt(data[key]));
-        size_t j = i;
-        
-        while (j > left && std::log(std::sqrt(data[indices[j-1]])) > key_value)
-        {
-            indices[j] = indices[j-1];
-            --j;
-        }
-        indices[j] = key;
+        speedup_kernels().merge(a, na, b, nb, dst);
+        return;
     }
+    MergeJob job = {a, na, b, nb, dst, segments};
+    ws_for(segments, merge_segment, &job);
 }
 
-// OpenMP 并行归并排序的合并函数（并行版本）
-void mergeParallel(const float data[], size_t* indices, size_t left, size_t mid, size_t right, size_t* temp, int depth)
+/*
+    两个缓冲区轮流作为合并的源与目标（ping-pong），不再把每层的合并结果拷贝回去：
+    要求结果落在 dst 的一段，先让两半的结果落在另一个缓冲区，再合并到 dst；
+    into_other 表示结果应落在 other（否则落在 src），只有长度不超过 32 的叶子在需要时拷贝一次
+*/
+static void sort_serial(float src[], float other[], size_t n, bool into_other)
 {
-    const size_t len = right - left + 1;
-    const int MAX_MERGE_DEPTH = 3;  // 合并的并行深度限制
-    
-    // 小区间或深度过深，直接串行合并
-    if (len < 8192 || depth >= MAX_MERGE_DEPTH)
+    if (n <= 32)
     {
-        size_t i = left;
-        size_t j = mid + 1;
-        size_t k = left;
-        
-        while (i <= mid && j <= right)
-        {
-            if (std::log(std::sqrt(data[indices[i]])) <= std::log(std::sqrt(data[indices[j]])))
-            {
-                temp[k++] = indices[i++];
-            }
-            else
-            {
-                temp[k++] = indices[j++];
-            }
-        }
-        
-        while (i <= mid)
-        {
-            temp[k++] = indices[i++];
-        }
-        
-        while (j <= right)
+        if (n > 1)
+            insertionSort(src, 0, n - 1);
+        if (into_other)
+            memcpy(other, src, n * sizeof(float));
+        return;
+    }
+
+    const size_t half = n / 2;
+    sort_serial(src, other, half, !into_other);
+    sort_serial(src + half, other + half, n - half, !into_other);
+    const float* from = into_other ? src : other;
+    float* to = into_other ? other : src;
+    speedup_kernels().merge(from, half, from + half, n - half, to);
+}
+
+struct SortJob
+{
+    float* src;
+    float* other;
+    size_t n;
+    bool into_other;
+    size_t run;         // 非 0 时每 run 个元素一段已经排好（流水线成段），只做合并
+};
+
+// 拆分点：从头排序时对半分；已成段时按段对齐，每段恰好是合并树的一个叶子
+static size_t sort_split(size_t n, size_t run)
+{
+    return (run == 0) ? n / 2 : ((n + run - 1) / run / 2) * run;
+}
+
+// 已成段时，从 offset 开始的一段排好后应当落在 other（temp）中还是 src（keys）中：
+// 与 sort_task 同样从根开始拆分，每下一层目标缓冲区交换一次
+static bool run_into_other(size_t n, size_t run, size_t offset)
+{
+    bool into_other = false;
+    size_t base = 0;
+    while (n > run)
+    {
+        const size_t half = sort_split(n, run);
+        if (offset < base + half)
         {
-            temp[k++] = indices[j++];
+            n = half;
         }
-        
-        for (size_t idx = left; idx <= right; idx++)
+        else
         {
-            indices[idx] = temp[idx];
+            base += half;
+            n -= half;
         }
+        into_other = !into_other;
+    }
+    return into_other;
+}
+
+// 递归排序任务：前一半作为任务压入队列（空闲线程可以窃取），后一半由当前线程继续拆分，
+// 两半的结果都落在另一个缓冲区后，并行合并到目标缓冲区；不超过 SORT_SERIAL_CUTOFF 时串行
+static void sort_task(void* p)
+{
+    const SortJob* job = (const SortJob*)p;
+    if (job->run != 0 && job->n <= job->run)
+    {
+        return;     // 流水线已把这一段排好，并按 run_into_other 放在了要求的缓冲区中
+    }
+    if (job->run == 0 && job->n <= SORT_SERIAL_CUTOFF)
+    {
+        sort_serial(job->src, job->other, job->n, job->into_other);
         return;
     }
-    
-    // 并行合并：分割成两段
-    size_t left_mid = left + (mid - left) / 2;
-    float pivot = std::log(std::sqrt(data[indices[left_mid]]));
-    
-    // 在右半段找第一个 >= pivot 的位置
-    size_t lo = mid + 1, hi = right + 1;
-    while (lo < hi)
+    TRACE_SCOPE("sort_task", job->n);
+
+    const size_t half = sort_split(job->n, job->run);
+    SortJob left = {job->src, job->other, half, !job->into_other, job->run};
+    SortJob right = {job->src + half, job->other + half, job->n - half, !job->into_other, job->run};
+    WsGroup group;
+    WsTask task;
+    ws_group_init(&group);
+    ws_spawn(&group, &task, sort_task, &left);
+    sort_task(&right);
+    ws_wait(&group);
+
+    const float* from = job->into_other ? job->src : job->other;
+    float* to = job->into_other ? job->other : job->src;
+    mergeParallel(from, half, from + half, job->n - half, to);
+}
+
+// 任务窃取式并行归并排序，temp 为同样大小的辅助数组，结果在 keys 中
+void mergeSortParallel(float keys[], size_t n, float temp[])
+{
+    SortJob job = {keys, temp, n, false, 0};
+    ws_run(sort_task, &job);
+}
+
+int sort_backend()
+{
+    static const int backend = sort_backend_from_env();
+    return backend;
+}
+
+int sort_backend_from_env()
+{
+    const char* name = getenv("PARDIST_SORT");
+    if (name == nullptr || strcmp(name, "radix") == 0)
+        return SORT_RADIX;
+    if (strcmp(name, "merge") == 0)
+        return SORT_MERGE;
+    printf("[Sort] 未知的 PARDIST_SORT=%s（可选 radix/merge），使用 radix\n", name);
+    return SORT_RADIX;
+}
+
+const char* sort_backend_name(int backend)
+{
+    return (backend == SORT_MERGE) ? "merge" : "radix";
+}
+
+// 加速的排序函数 - 键预计算 + 可选的排序后端
+// log(sqrt(x)) 单调递增，先把每个元素变换一次写入连续的键数组（即结果数组），
+// 再直接对键排序，比较时不再调用超越函数，也不再经过索引数组间接访问
+void sortSpeedUp(const float data[], const int len, float* result)
+{
+    sortSpeedUpWith(sort_backend(), data, len, result);
+}
+
+void sortSpeedUpWith(int backend, const float data[], const int len, float* result)
+{
+    if (len <= 0)
     {
-        size_t m = lo + (hi - lo) / 2;
-        if (std::log(std::sqrt(data[indices[m]])) < pivot)
-            lo = m + 1;
-        else
-            hi = m;
+        return;
     }
-    size_t right_mid = (lo > mid + 1) ? lo - 1 : mid;
-    
-    // 计算pivot在temp中的最终位置
-    size_t k_mid = left + (left_mid - left) + (right_mid - mid);
-    temp[k_mid] = indices[left_mid];
-    
-    // 并行合并两段（不含pivot）
-    const int next_depth = depth + 1;
-    if (left < left_mid)
+
+    speedup_kernels().log_keys(data, len, result);
+
+    sortKeys(backend, result, len, arena_floats(ARENA_SCRATCH_B, len));
+}
+
+const char* transform_name(int transform)
+{
+    switch (transform)
     {
-        #pragma omp task shared(data, indices, temp) if(next_depth < MAX_MERGE_DEPTH)
-        mergeParallel(data, indices, left, left_mid - 1, right_mid, temp, next_depth);
+        case TRANSFORM_LOG_SQRT: return LogSqrtTransform::name();
+        case TRANSFORM_SQRT:     return SqrtTransform::name();
+        case TRANSFORM_SQUARE:   return SquareTransform::name();
+        default:                 return "?";
     }
-    
-    if (left_mid + 1 <= mid)
+}
+
+int transform_from_env()
+{
+    const char* name = getenv("PARDIST_TRANSFORM");
+    if (name == nullptr)
+        return TRANSFORM_LOG_SQRT;
+    for (int t = 0; t < TRANSFORM_COUNT; t++)
     {
-        #pragma omp task shared(data, indices, temp) if(next_depth < MAX_MERGE_DEPTH)
-        mergeParallel(data, indices, left_mid + 1, mid, right, temp, next_depth);
+        if (strcmp(name, transform_name(t)) == 0)
+            return t;
     }
-    
-    #pragma omp taskwait
-    
-    // 拷贝回indices
-    for (size_t idx = left; idx <= right; idx++)
+    printf("[Transform] 未知的 PARDIST_TRANSFORM=%s（可选 log_sqrt/sqrt/square），使用 log_sqrt\n", name);
+    return TRANSFORM_LOG_SQRT;
+}
+
+bool transform_monotonic(int transform)
+{
+    switch (transform)
     {
-        indices[idx] = temp[idx];
+        case TRANSFORM_LOG_SQRT: return LogSqrtTransform::monotonic;
+        case TRANSFORM_SQRT:     return SqrtTransform::monotonic;
+        default:                 return SquareTransform::monotonic;
     }
 }
 
-// OpenMP 并行归并排序递归函数（修复版）
-void mergeSortParallel(const float data[], size_t* indices, size_t left, size_t right, size_t* temp, int depth)
+void sumMaxTransformed(int transform, const float data[], const int len, float* sum, float* max)
 {
-    if (left >= right) return;
-    
-    const size_t len = right - left + 1;
-    
-    // 小数组用插入排序
-    if (len <= 32)
+    speedup_kernels().transforms[transform].sum_max(data, len, sum, max);
+}
+
+// 任意变换的排序同样先把每个元素变换一次写入键数组再排序，比较时不调用变换，
+// 单调与否都不影响这条路径（基础版本才需要区分，见 basic.cpp）
+void sortTransformed(int transform, const float data[], const int len, float* result)
+{
+    if (len <= 0)
     {
-        insertionSort(data, indices, left, right);
         return;
     }
-    
-    size_t mid = left + (right - left) / 2;
-    
-    // 动态阈值：根据线程数和深度判断（优化后）
-    const int max_threads = omp_get_max_threads();
-    const size_t grainsize = (max_threads > 1) ? (max_threads * 2048) : 32768;
-    const int MAX_DEPTH = 10;  // 增大深度限制，让更多task并行
-    
-    // 只在数据足够大且深度合理时才并行
-    if (len > grainsize && depth < MAX_DEPTH)
+
+    speedup_kernels().transforms[transform].keys(data, len, result);
+
+    sortKeys(sort_backend(), result, len, arena_floats(ARENA_SCRATCH_B, len));
+}
+
+// argsort：键与 uint32 下标组成 8 字节的对一起做基数排序，需要原始位置的调用者使用
+// 下标用 uint32（len 为 int），每个元素的访存量是键-size_t 对的 2/3
+void argsortSpeedUp(const float data[], const int len, KeyIndex result[])
+{
+    if (len <= 0)
     {
-        // 使用 firstprivate 传递参数，temp 共享
-        #pragma omp task shared(data, indices, temp) firstprivate(left, mid, depth)
-        mergeSortParallel(data, indices, left, mid, temp, depth + 1);
-        
-        #pragma omp task shared(data, indices, temp) firstprivate(mid, right, depth)
-        mergeSortParallel(data, indices, mid + 1, right, temp, depth + 1);
-        
-        #pragma omp taskwait  // 确保两个子任务完成
+        return;
+    }
+
+    float* keys = arena_floats(ARENA_SCRATCH_A, len);
+    speedup_kernels().log_keys(data, len, keys);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < len; i++)
+    {
+        result[i].key = keys[i];
+        result[i].index = (uint32_t)i;
+    }
+    radixSortPairs(result, len, (KeyIndex*)arena_get(ARENA_SCRATCH_B, (size_t)len * sizeof(KeyIndex)));
+}
+
+// 键变换 keys[i] = log(sqrt(data[i]))，供分布式排序先变换、再交换、最后排序
+void computeSortKeys(const float data[], const int len, float keys[])
+{
+    speedup_kernels().log_keys(data, len, keys);
+}
+
+SortRuns sort_runs_prepare(int backend, float keys[], size_t n, float temp[])
+{
+    SortRuns runs = {backend, keys, temp, n, nullptr};
+    if (backend == SORT_RADIX && n > 0)
+    {
+        const size_t blocks = (n + SHUFFLE_BLOCK - 1) / SHUFFLE_BLOCK;
+        runs.hist = (uint32_t*)arena_get(ARENA_HISTOGRAM, blocks * RADIX_BUCKETS * sizeof(uint32_t));
+    }
+    return runs;
+}
+
+void sort_runs_block(const SortRuns& runs, size_t offset, size_t len)
+{
+    if (runs.backend == SORT_RADIX)
+    {
+        radixBlockHistogram(runs.keys + offset, len, runs.hist + offset / SHUFFLE_BLOCK * RADIX_BUCKETS);
     }
     else
     {
-        // 串行处理
-        mergeSortParallel(data, indices, left, mid, temp, depth + 1);
-        mergeSortParallel(data, indices, mid + 1, right, temp, depth + 1);
+        sort_serial(runs.keys + offset, runs.temp + offset, len, run_into_other(runs.n, SHUFFLE_BLOCK, offset));
     }
-    
-    // 合并阶段（并行merge）
-    mergeParallel(data, indices, left, mid, right, temp, 0);
 }
 
-// 加速的排序函数 - 使用 OpenMP Task 并行（优化版）
-void sortSpeedUp(const float data[], const int len, float* result)
+void sort_runs_finish(const SortRuns& runs)
 {
-    // 创建索引数组（并行初始化）
-    size_t* sortIndices = new size_t[len];
-    #pragma omp parallel for
-    for (int i = 0; i < len; i++)
+    if (runs.n < 2)
     {
-        sortIndices[i] = i;
+        return;
     }
-    
-    // 创建临时数组
-    size_t* tempIndices = new size_t[len];
-    
-    // 使用 OpenMP 并行归并排序
-    #pragma omp parallel
+    TRACE_SCOPE("sort", runs.n);
+
+    if (runs.backend == SORT_RADIX)
     {
-        #pragma omp single
-        {
-            mergeSortParallel(data, sortIndices, 0, len - 1, tempIndices, 0);
-        }
+        radixSortKeysBlocked(runs.keys, runs.n, runs.temp, runs.hist, SHUFFLE_BLOCK);
     }
-    
-    // 填充结果数组 - 轻量级并行（分块策略）
-    const int block = (len + 3) / 4;
-    #pragma omp parallel for schedule(static, block)
-    for (int i = 0; i < len; i++)
+    else
+    {
+        SortJob job = {runs.keys, runs.temp, runs.n, false, SHUFFLE_BLOCK};
+        ws_run(sort_task, &job);
+    }
+}
+
+// 对已经计算好的键排序，temp 为同样大小的辅助数组，结果写回 keys
+void sortKeys(int backend, float keys[], size_t n, float temp[])
+{
+    if (n < 2)
+    {
+        return;
+    }
+    TRACE_SCOPE("sort", n);
+
+    if (backend == SORT_RADIX)
+    {
+        // 并行 LSD 基数排序：3 趟线性扫描，访存量与数据分布无关
+        radixSortKeys(keys, n, temp);
+    }
+    else
     {
-        result[i] = std::log(std::sqrt(data[sortIndices[i]]));
+        // 任务窃取调度器驱动的并行归并排序
+        mergeSortParallel(keys, n, temp);
     }
-    
-    delete[] tempIndices;
-    delete[] sortIndices;
 }
\ No newline at end of file
@@ -0,0 +1,171 @@
+/*
+    阶段追踪：每线程环形缓冲区 + Chrome trace 导出，见 trace.hpp
+*/
+
+#include "trace.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <errno.h>
+#include <mutex>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <omp.h>
+
+bool g_traceEnabled = false;
+
+struct TraceEvent
+{
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+    uint64_t arg;
+};
+
+// 只有所属线程写入；trace_write 在各线程停止记录之后读取
+struct TraceRing
+{
+    TraceEvent events[TRACE_RING_EVENTS];
+    uint64_t count;         // 累计记录的事件个数，超过容量后环形覆盖
+    long tid;
+    char thread_name[32];
+};
+
+static const char* g_tracePrefix = nullptr;
+static std::mutex g_traceMutex;             // 只保护线程登记
+static std::vector<TraceRing*> g_traceRings;
+static thread_local TraceRing* t_ring = nullptr;
+
+// TSC 与墙上时间的对应关系：us = g_wallBaseUs + (tsc - g_tscBase) / g_ticksPerUs
+static uint64_t g_tscBase;
+static double g_wallBaseUs;
+static double g_ticksPerUs = 1.0;
+
+static double now_us(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// 对照 CLOCK_MONOTONIC 测 20 ms 内的 TSC 增量（现代 x86 的 TSC 频率恒定，不随睿频变化）
+static void calibrate_tsc()
+{
+    const double mono_start = now_us(CLOCK_MONOTONIC);
+    const uint64_t tsc_start = __rdtsc();
+    struct timespec pause = {0, 20 * 1000 * 1000};
+    nanosleep(&pause, nullptr);
+    const double mono_end = now_us(CLOCK_MONOTONIC);
+    const uint64_t tsc_end = __rdtsc();
+    g_ticksPerUs = (double)(tsc_end - tsc_start) / (mono_end - mono_start);
+
+    g_tscBase = __rdtsc();
+    g_wallBaseUs = now_us(CLOCK_REALTIME);
+}
+
+void trace_init()
+{
+    const char* prefix = getenv("PARDIST_TRACE");
+    if (prefix == nullptr || prefix[0] == '\0')
+        return;
+    g_tracePrefix = prefix;
+    calibrate_tsc();
+    g_traceEnabled = true;
+    printf("[Trace] 已开启，TSC %.3f GHz，每线程最多保留 %d 个事件\n", g_ticksPerUs / 1e3, TRACE_RING_EVENTS);
+}
+
+// 线程第一次记录时分配并登记环形缓冲区；OpenMP 线程按线程号命名
+static TraceRing* thread_ring()
+{
+    if (t_ring == nullptr)
+    {
+        TraceRing* ring = new TraceRing;
+        ring->count = 0;
+        ring->tid = (long)syscall(SYS_gettid);
+        if (omp_in_parallel())
+            snprintf(ring->thread_name, sizeof(ring->thread_name), "omp-%d", omp_get_thread_num());
+        else
+            snprintf(ring->thread_name, sizeof(ring->thread_name), "thread-%ld", ring->tid);
+        std::lock_guard<std::mutex> lock(g_traceMutex);
+        g_traceRings.push_back(ring);
+        t_ring = ring;
+    }
+    return t_ring;
+}
+
+void trace_record(const char* name, uint64_t begin, uint64_t end, uint64_t arg)
+{
+    TraceRing* ring = thread_ring();
+    TraceEvent& e = ring->events[ring->count % TRACE_RING_EVENTS];
+    e.name = name;
+    e.begin = begin;
+    e.end = end;
+    e.arg = arg;
+    ring->count++;
+}
+
+void trace_set_thread_name(const char* name)
+{
+    if (!g_traceEnabled)
+        return;
+    TraceRing* ring = thread_ring();
+    snprintf(ring->thread_name, sizeof(ring->thread_name), "%s", name);
+}
+
+static double tsc_to_us(uint64_t tsc)
+{
+    return g_wallBaseUs + ((double)(int64_t)(tsc - g_tscBase)) / g_ticksPerUs;
+}
+
+bool trace_write(const char* role)
+{
+    if (!g_traceEnabled)
+        return true;
+
+    char path[4096];
+    const int pid = (int)getpid();
+    snprintf(path, sizeof(path), "%s.%s.%d.json", g_tracePrefix, role, pid);
+    FILE* f = fopen(path, "w");
+    if (f == nullptr)
+    {
+        printf("[Trace] 无法写入 %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(g_traceMutex);
+    fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(f, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"%s %d\"}}", pid, role, pid);
+
+    size_t written = 0, dropped = 0;
+    for (size_t r = 0; r < g_traceRings.size(); r++)
+    {
+        const TraceRing* ring = g_traceRings[r];
+        fprintf(f, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %ld, \"args\": {\"name\": \"%s\"}}",
+                pid, ring->tid, ring->thread_name);
+
+        // 环形缓冲区写满后只剩最近的 TRACE_RING_EVENTS 个事件
+        const uint64_t first = (ring->count > TRACE_RING_EVENTS) ? ring->count - TRACE_RING_EVENTS : 0;
+        dropped += (size_t)first;
+        for (uint64_t i = first; i < ring->count; i++)
+        {
+            const TraceEvent& e = ring->events[i % TRACE_RING_EVENTS];
+            // 墙上时间的绝对微秒数在 double 中只精确到 0.25 us，持续时间直接由 TSC 差值换算
+            const double ts = tsc_to_us(e.begin);
+            fprintf(f, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": %d, \"tid\": %ld, \"ts\": %.3f, \"dur\": %.3f, "
+                    "\"args\": {\"n\": %llu}}",
+                    e.name, pid, ring->tid, ts, (double)(e.end - e.begin) / g_ticksPerUs, (unsigned long long)e.arg);
+            written++;
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+
+    printf("[Trace] %zu 个线程、%zu 个事件已写入 %s", g_traceRings.size(), written, path);
+    if (dropped > 0)
+        printf("（环形缓冲区覆盖了最早的 %zu 个事件）", dropped);
+    printf("\n");
+    return true;
+}
@@ -0,0 +1,919 @@
+/*
+    UDP 可靠传输层实现
+    所有包共用一个套接字，由接收线程统一收包：
+    控制消息交给回调，数据包按偏移写入登记的缓冲区，确认包更新发送方状态
+    接收线程阻塞在 epoll_wait 上，套接字可读时一次取完已到达的包，eventfd 可读时退出
+*/
+
+#include "transport.hpp"
+#include "network_config.h"
+#include "trace.hpp"
+
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <linux/errqueue.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+
+// 数据包类型
+enum PacketKind
+{
+    PKT_CTRL = 1,       // 控制消息
+    PKT_CTRL_ACK = 2,   // 控制消息确认
+    PKT_DATA = 3,       // 大块数据包
+    PKT_DATA_ACK = 4    // 数据确认：累计确认 + SACK 位图
+};
+
+// 数据包报头
+struct PacketHeader
+{
+    uint32_t magic;
+    uint8_t kind;
+    uint8_t reserved;
+    uint16_t chunk;     // DATA: 每包负载字节数（最后一包可以更短）
+    uint32_t epoch;     // 发送端进程标识，对端重启后重置去重状态
+    uint32_t stream;    // DATA/DATA_ACK: 流编号
+    uint32_t seq;       // CTRL/CTRL_ACK: 控制消息序号; DATA: 包序号; DATA_ACK: 累计确认
+    uint32_t length;    // 负载字节数
+    uint64_t total;     // DATA: 整个流的字节数
+};
+
+static const uint32_t PACKET_MAGIC = 0x50445450;   // "PDTP"
+static const size_t IP_UDP_OVERHEAD = 28;
+static const size_t MAX_PACKET = 65507;
+static const int ACK_SACK_WORDS = 16;              // SACK 位图覆盖累计确认之后的 1024 个包
+static const uint32_t STREAM_COMPLETE = 0xFFFFFFFFu;
+static const int MAX_RTO_MS = 1000;
+static const size_t ZEROCOPY_MAX_PAYLOAD = 15 * 4096;
+
+// 对端状态：控制消息去重
+struct PeerState
+{
+    struct sockaddr_in addr;
+    uint32_t epoch;
+    uint32_t last_ctrl_seq;
+};
+
+// 发送中的大块数据流
+struct BulkSend
+{
+    struct sockaddr_in peer;
+    uint32_t stream;
+    uint32_t npkts;
+    uint32_t cum;           // 累计确认：[0, cum) 全部确认
+    uint32_t highest;       // SACK 中见到的最大包序号 + 1
+    std::vector<uint8_t> acked;
+    uint64_t last_progress_us;
+};
+
+// 登记的接收流
+struct BulkRecv
+{
+    uint32_t stream;
+    char* buffer;
+    size_t capacity;
+    size_t elem_size;
+    std::atomic<size_t>* ready;
+    struct sockaddr_in peer;
+    uint64_t total;
+    uint32_t chunk;
+    uint32_t npkts;         // 0 表示还未收到第一个包
+    uint32_t cum;
+    std::vector<uint8_t> received;
+    bool need_ack;
+};
+
+static int g_sock = -1;
+static TransportConfig g_cfg;
+static uint32_t g_epoch = 0;
+
+static std::mutex g_mutex;               // 保护下面所有状态
+static std::condition_variable g_cond;   // 确认到达时唤醒发送方
+static std::mutex g_ctrlSendMutex;       // 控制消息逐条发送（停等）
+static uint32_t g_ctrlSeq = 0;
+static uint32_t g_ctrlAcked = 0;
+static std::vector<PeerState> g_peers;
+static std::vector<BulkSend*> g_sends;
+static std::vector<BulkRecv*> g_recvs;
+static std::vector<uint32_t> g_closedStreams;
+
+static int g_epollFd = -1;
+static int g_wakeFd = -1;                // eventfd：写入后接收线程退出
+static std::atomic<bool> g_shutdown(false);
+static std::atomic<bool> g_waitsCancelled(false);
+
+// 事件计数与等待者（与 g_mutex 分开，等待上层条件的线程不与收包争锁）
+static std::mutex g_eventMutex;
+static std::condition_variable g_eventCond;
+static std::atomic<uint64_t> g_events(0);
+
+static std::atomic<uint64_t> g_packetsSent(0);
+static std::atomic<uint64_t> g_packetsRetransmitted(0);
+static std::atomic<uint64_t> g_packetsReceived(0);
+static std::atomic<uint64_t> g_packetsDropped(0);
+static std::atomic<uint64_t> g_bulkBytes(0);
+static std::atomic<uint64_t> g_bulkUs(0);
+
+// MSG_ZEROCOPY：内核给套接字上每次零拷贝发送依次编号，完成后在错误队列中通知一个编号区间
+static std::atomic<uint64_t> g_zcIssued(0);     // 已发出的零拷贝包数
+static std::atomic<uint64_t> g_zcCompleted(0);  // 内核已释放引用的包数
+static std::atomic<uint64_t> g_zcCopied(0);     // 其中被内核复制的包数
+
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+static bool same_addr(const struct sockaddr_in& a, const struct sockaddr_in& b)
+{
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+// 每个数据包的负载字节数，取8的倍数保证 float/double 不跨包
+static uint32_t payload_size()
+{
+    size_t mtu = std::min(g_cfg.mtu, MAX_PACKET + IP_UDP_OVERHEAD);
+    size_t payload = mtu - IP_UDP_OVERHEAD - sizeof(PacketHeader);
+    payload &= ~(size_t)7;
+    // 零拷贝时每个页面是 skb 的一个分片：报头占 1 个，未对齐的负载最多再占 16 个（MAX_SKB_FRAGS = 17），
+    // 超过时内核返回 EMSGSIZE
+    if (g_cfg.zerocopy)
+        payload = std::min<size_t>(payload, ZEROCOPY_MAX_PAYLOAD);
+    return (uint32_t)std::min<size_t>(payload, 0xFFF8);
+}
+
+// 接收端注入丢包用的随机数（只在接收线程中使用）
+static uint64_t g_lossRng = 0x9E3779B97F4A7C15ull;
+static double next_random()
+{
+    g_lossRng ^= g_lossRng << 13;
+    g_lossRng ^= g_lossRng >> 7;
+    g_lossRng ^= g_lossRng << 17;
+    return (g_lossRng >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void fill_header(PacketHeader& header, uint8_t kind, uint32_t stream, uint32_t seq, uint32_t length)
+{
+    memset(&header, 0, sizeof(header));
+    header.magic = PACKET_MAGIC;
+    header.kind = kind;
+    header.epoch = g_epoch;
+    header.stream = stream;
+    header.seq = seq;
+    header.length = length;
+}
+
+static void send_packet(const struct sockaddr_in& peer, const PacketHeader& header, const void* payload, size_t len)
+{
+    struct iovec iov[2];
+    iov[0].iov_base = (void*)&header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = (void*)payload;
+    iov[1].iov_len = len;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = (void*)&peer;
+    msg.msg_namelen = sizeof(peer);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = (len > 0) ? 2 : 1;
+    sendmsg(g_sock, &msg, 0);
+    g_packetsSent++;
+}
+
+static void set_socket_buffer(int sock, int force_opt, int opt, int size)
+{
+    // 有 CAP_NET_ADMIN 时可以突破 rmem_max/wmem_max 的限制
+    if (setsockopt(sock, SOL_SOCKET, force_opt, &size, sizeof(size)) < 0)
+    {
+        setsockopt(sock, SOL_SOCKET, opt, &size, sizeof(size));
+    }
+}
+
+void transport_init(int sock)
+{
+    g_sock = sock;
+
+    g_cfg.mtu = TRANSPORT_MTU;
+    g_cfg.window = TRANSPORT_WINDOW;
+    g_cfg.rto_ms = TRANSPORT_RTO_MS;
+    g_cfg.loss_rate = 0.0;
+    g_cfg.zerocopy = false;
+    g_cfg.wait_timeout_ms = TRANSPORT_WAIT_TIMEOUT_MS;
+
+    const char* env;
+    if ((env = getenv("PARDIST_MTU")) != NULL && atoi(env) > (int)(IP_UDP_OVERHEAD + sizeof(PacketHeader) + 8))
+        g_cfg.mtu = atoi(env);
+    if ((env = getenv("PARDIST_WINDOW")) != NULL && atoi(env) > 0)
+        g_cfg.window = std::min(atoi(env), ACK_SACK_WORDS * 64);
+    if ((env = getenv("PARDIST_RTO_MS")) != NULL && atoi(env) > 0)
+        g_cfg.rto_ms = atoi(env);
+    if ((env = getenv("PARDIST_LOSS_RATE")) != NULL)
+        g_cfg.loss_rate = atof(env);
+    if ((env = getenv("PARDIST_WAIT_TIMEOUT_MS")) != NULL && atoi(env) >= 0)
+        g_cfg.wait_timeout_ms = atoi(env);
+    if ((env = getenv("PARDIST_ZEROCOPY")) != NULL && atoi(env) > 0)
+    {
+        int one = 1;
+        g_cfg.zerocopy = setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+        if (!g_cfg.zerocopy)
+            printf("[Transport] SO_ZEROCOPY not supported (%s), using copying sends\n", strerror(errno));
+    }
+
+    set_socket_buffer(sock, SO_RCVBUFFORCE, SO_RCVBUF, TRANSPORT_SOCKET_BUFFER);
+    set_socket_buffer(sock, SO_SNDBUFFORCE, SO_SNDBUF, TRANSPORT_SOCKET_BUFFER);
+
+    g_shutdown = false;
+    g_waitsCancelled = false;
+    g_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    g_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = sock;
+    epoll_ctl(g_epollFd, EPOLL_CTL_ADD, sock, &ev);
+    ev.data.fd = g_wakeFd;
+    epoll_ctl(g_epollFd, EPOLL_CTL_ADD, g_wakeFd, &ev);
+
+    g_epoch = (uint32_t)(now_us() ^ ((uint64_t)getpid() << 16));
+    if (g_epoch == 0)
+        g_epoch = 1;
+    g_lossRng ^= g_epoch;
+
+    printf("[Transport] MTU %zu (payload %u B), window %u pkts, RTO %d ms",
+           g_cfg.mtu, payload_size(), g_cfg.window, g_cfg.rto_ms);
+    if (g_cfg.loss_rate > 0)
+        printf(", injected loss %.2f%%", g_cfg.loss_rate * 100);
+    if (g_cfg.zerocopy)
+        printf(", MSG_ZEROCOPY");
+    printf("\n");
+}
+
+const TransportConfig& transport_config()
+{
+    return g_cfg;
+}
+
+TransportStats transport_stats()
+{
+    TransportStats stats;
+    stats.packets_sent = g_packetsSent;
+    stats.packets_retransmitted = g_packetsRetransmitted;
+    stats.packets_received = g_packetsReceived;
+    stats.packets_dropped = g_packetsDropped;
+    stats.bulk_bytes = g_bulkBytes;
+    stats.bulk_us = g_bulkUs;
+    stats.zerocopy_sends = g_zcIssued;
+    stats.zerocopy_copied = g_zcCopied;
+    return stats;
+}
+
+void transport_print_stats()
+{
+    TransportStats st = transport_stats();
+    printf("[Transport] 发送 %llu 包（重传 %llu），接收 %llu 包（注入丢弃 %llu）\n",
+           (unsigned long long)st.packets_sent, (unsigned long long)st.packets_retransmitted,
+           (unsigned long long)st.packets_received, (unsigned long long)st.packets_dropped);
+    if (st.bulk_us > 0)
+    {
+        printf("[Transport] 大块发送 %.1f MB，用时 %.1f ms，%.1f MB/s", st.bulk_bytes / 1e6, st.bulk_us / 1e3,
+               (double)st.bulk_bytes / st.bulk_us);
+        if (g_cfg.zerocopy)
+            printf("；零拷贝 %llu 包，其中内核回退复制 %llu 包",
+                   (unsigned long long)st.zerocopy_sends, (unsigned long long)st.zerocopy_copied);
+        printf("\n");
+    }
+}
+
+// ===== 事件通知 =====
+
+static void signal_event()
+{
+    {
+        std::lock_guard<std::mutex> lock(g_eventMutex);
+        g_events++;
+    }
+    g_eventCond.notify_all();
+}
+
+uint64_t transport_events()
+{
+    return g_events.load(std::memory_order_acquire);
+}
+
+bool transport_wait_event(uint64_t seen, int timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(g_eventMutex);
+    auto ready = [seen] { return g_events.load() != seen || g_shutdown.load() || g_waitsCancelled.load(); };
+    if (timeout_ms > 0)
+        g_eventCond.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+    else
+        g_eventCond.wait(lock, ready);
+    return !g_shutdown.load() && !g_waitsCancelled.load();
+}
+
+void transport_cancel_waits()
+{
+    g_waitsCancelled = true;
+    signal_event();
+}
+
+void transport_shutdown()
+{
+    g_shutdown = true;
+    uint64_t one = 1;
+    if (write(g_wakeFd, &one, sizeof(one)) < 0)
+        printf("[Transport] eventfd write failed: %s\n", strerror(errno));
+    signal_event();
+}
+
+// ===== 接收端处理（调用者持有 g_mutex） =====
+
+static BulkRecv* find_recv(uint32_t stream)
+{
+    for (size_t i = 0; i < g_recvs.size(); i++)
+        if (g_recvs[i]->stream == stream)
+            return g_recvs[i];
+    return NULL;
+}
+
+static BulkSend* find_send(uint32_t stream, const struct sockaddr_in& peer)
+{
+    for (size_t i = 0; i < g_sends.size(); i++)
+        if (g_sends[i]->stream == stream && same_addr(g_sends[i]->peer, peer))
+            return g_sends[i];
+    return NULL;
+}
+
+// 回复数据确认：累计确认 + 之后 1024 个包的接收位图
+static void send_data_ack(const struct sockaddr_in& peer, uint32_t stream, const BulkRecv* r)
+{
+    uint64_t sack[ACK_SACK_WORDS];
+    memset(sack, 0, sizeof(sack));
+    uint32_t cum = STREAM_COMPLETE;
+    if (r != NULL && r->cum < r->npkts)
+    {
+        cum = r->cum;
+        uint32_t end = std::min<uint32_t>(r->npkts, cum + ACK_SACK_WORDS * 64);
+        for (uint32_t seq = cum + 1; seq < end; seq++)
+        {
+            if (r->received[seq])
+            {
+                uint32_t bit = seq - cum;
+                sack[bit >> 6] |= 1ull << (bit & 63);
+            }
+        }
+    }
+
+    PacketHeader header;
+    fill_header(header, PKT_DATA_ACK, stream, cum, sizeof(sack));
+    send_packet(peer, header, sack, sizeof(sack));
+}
+
+static void on_data(const struct sockaddr_in& from, const PacketHeader& header, const char* payload)
+{
+    BulkRecv* r = find_recv(header.stream);
+    if (r == NULL)
+    {
+        // 已结束的流：对端没收到最后的确认，直接回复完成
+        if (std::find(g_closedStreams.begin(), g_closedStreams.end(), header.stream) != g_closedStreams.end())
+            send_data_ack(from, header.stream, NULL);
+        return;
+    }
+
+    if (r->npkts == 0)
+    {
+        if (header.total > r->capacity || header.chunk == 0)
+        {
+            printf("[Transport] stream %u: %llu bytes exceeds posted buffer (%zu)\n",
+                   header.stream, (unsigned long long)header.total, r->capacity);
+            return;
+        }
+        r->total = header.total;
+        r->chunk = header.chunk;
+        r->npkts = (uint32_t)std::max<uint64_t>(1, (header.total + header.chunk - 1) / header.chunk);
+        r->received.assign(r->npkts, 0);
+    }
+
+    uint64_t offset = (uint64_t)header.seq * r->chunk;
+    if (header.seq >= r->npkts || offset + header.length > r->total)
+        return;
+
+    r->peer = from;
+    r->need_ack = true;
+    if (r->received[header.seq])
+        return;
+
+    memcpy(r->buffer + offset, payload, header.length);
+    r->received[header.seq] = 1;
+    if (header.seq == r->cum)
+    {
+        while (r->cum < r->npkts && r->received[r->cum])
+            r->cum++;
+        size_t ready_bytes = (r->cum == r->npkts) ? r->total : (size_t)r->cum * r->chunk;
+        if (r->ready != NULL)
+            r->ready->store(ready_bytes / r->elem_size, std::memory_order_release);
+    }
+}
+
+static void on_data_ack(const struct sockaddr_in& from, const PacketHeader& header, const char* payload)
+{
+    BulkSend* s = find_send(header.stream, from);
+    if (s == NULL || header.length < ACK_SACK_WORDS * sizeof(uint64_t))
+        return;
+
+    uint32_t old_cum = s->cum;
+    uint32_t cum = (header.seq == STREAM_COMPLETE) ? s->npkts : std::min(header.seq, s->npkts);
+    for (uint32_t seq = s->cum; seq < cum; seq++)
+        s->acked[seq] = 1;
+
+    uint64_t sack[ACK_SACK_WORDS];
+    memcpy(sack, payload, sizeof(sack));
+    for (int w = 0; w < ACK_SACK_WORDS; w++)
+    {
+        uint64_t bits = sack[w];
+        while (bits)
+        {
+            int b = __builtin_ctzll(bits);
+            bits &= bits - 1;
+            uint32_t seq = cum + w * 64 + b;
+            if (seq < s->npkts)
+            {
+                s->acked[seq] = 1;
+                s->highest = std::max(s->highest, seq + 1);
+            }
+        }
+    }
+
+    while (s->cum < s->npkts && s->acked[s->cum])
+        s->cum++;
+    if (s->cum != old_cum)
+    {
+        s->last_progress_us = now_us();
+        g_cond.notify_all();
+    }
+}
+
+// 控制消息去重，返回是否为新消息
+static bool accept_control(const struct sockaddr_in& from, const PacketHeader& header)
+{
+    for (size_t i = 0; i < g_peers.size(); i++)
+    {
+        PeerState& p = g_peers[i];
+        if (!same_addr(p.addr, from))
+            continue;
+        if (p.epoch != header.epoch)
+        {
+            p.epoch = header.epoch;
+            p.last_ctrl_seq = 0;
+        }
+        if (header.seq <= p.last_ctrl_seq)
+            return false;
+        p.last_ctrl_seq = header.seq;
+        return true;
+    }
+
+    PeerState p;
+    p.addr = from;
+    p.epoch = header.epoch;
+    p.last_ctrl_seq = header.seq;
+    g_peers.push_back(p);
+    return true;
+}
+
+// 取回错误队列中的零拷贝完成通知，唤醒等待缓冲区释放的发送方
+static void drain_zerocopy_completions()
+{
+    char control[256];
+    uint64_t completed = 0;
+    while (1)
+    {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(g_sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            break;
+
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (cm->cmsg_level != SOL_IP || cm->cmsg_type != IP_RECVERR)
+                continue;
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cm), sizeof(err));
+            if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0)
+                continue;
+            // [ee_info, ee_data] 区间内的发送全部完成
+            uint64_t n = (uint64_t)(err.ee_data - err.ee_info) + 1;
+            completed += n;
+            if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                g_zcCopied += n;
+        }
+    }
+
+    if (completed > 0)
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_zcCompleted += completed;
+        g_cond.notify_all();
+    }
+}
+
+// 一次批量收包中需要交给回调的控制消息
+struct PendingControl
+{
+    struct sockaddr_in from;
+    const char* msg;
+    size_t len;
+};
+
+void transport_receive_loop(ControlHandler handler)
+{
+    const int B = TRANSPORT_BATCH;
+    std::vector<char> storage((size_t)B * MAX_PACKET);
+    std::vector<struct mmsghdr> msgs(B);
+    std::vector<struct iovec> iovs(B);
+    std::vector<struct sockaddr_in> addrs(B);
+    std::vector<PendingControl> pending;
+    std::vector<BulkRecv*> touched;
+
+    for (int i = 0; i < B; i++)
+    {
+        iovs[i].iov_base = &storage[(size_t)i * MAX_PACKET];
+        iovs[i].iov_len = MAX_PACKET;
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+    }
+
+    bool readable = false;
+    while (!g_shutdown)
+    {
+        // 上一批取满时套接字里可能还有包，不经过 epoll 直接再取
+        if (!readable)
+        {
+            struct epoll_event events[2];
+            int ready = epoll_wait(g_epollFd, events, 2, -1);
+            if (ready < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                printf("[Transport] epoll_wait failed: %s\n", strerror(errno));
+                break;
+            }
+            for (int i = 0; i < ready; i++)
+            {
+                if (events[i].data.fd != g_sock)
+                    continue;
+                if (events[i].events & EPOLLERR)
+                    drain_zerocopy_completions();
+                if (events[i].events & EPOLLIN)
+                    readable = true;
+            }
+            if (g_shutdown || !readable)
+                continue;
+        }
+
+        for (int i = 0; i < B; i++)
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+
+        // 非阻塞地把已到达的包一次取完
+        int n = recvmmsg(g_sock, msgs.data(), B, MSG_DONTWAIT, NULL);
+        if (n <= 0)
+        {
+            readable = false;
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                printf("[Transport] recvmmsg failed: %s\n", strerror(errno));
+            continue;
+        }
+        readable = (n == B);
+
+        TRACE_SCOPE("recv_batch", n);
+        pending.clear();
+        touched.clear();
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            for (int i = 0; i < n; i++)
+            {
+                const char* packet = (const char*)iovs[i].iov_base;
+                size_t len = msgs[i].msg_len;
+                if (len < sizeof(PacketHeader))
+                    continue;
+                if (g_cfg.loss_rate > 0 && next_random() < g_cfg.loss_rate)
+                {
+                    g_packetsDropped++;
+                    continue;
+                }
+
+                PacketHeader header;
+                memcpy(&header, packet, sizeof(header));
+                if (header.magic != PACKET_MAGIC || sizeof(header) + header.length > len)
+                    continue;
+                g_packetsReceived++;
+
+                const char* payload = packet + sizeof(header);
+                const struct sockaddr_in& from = addrs[i];
+                switch (header.kind)
+                {
+                case PKT_CTRL:
+                {
+                    PacketHeader ack;
+                    fill_header(ack, PKT_CTRL_ACK, 0, header.seq, 0);
+                    send_packet(from, ack, NULL, 0);
+                    if (accept_control(from, header))
+                    {
+                        PendingControl pc;
+                        pc.from = from;
+                        pc.msg = payload;
+                        pc.len = header.length;
+                        pending.push_back(pc);
+                    }
+                    break;
+                }
+                case PKT_CTRL_ACK:
+                    if (header.seq == g_ctrlSeq)
+                    {
+                        g_ctrlAcked = header.seq;
+                        g_cond.notify_all();
+                    }
+                    break;
+                case PKT_DATA:
+                {
+                    on_data(from, header, payload);
+                    BulkRecv* r = find_recv(header.stream);
+                    if (r != NULL && std::find(touched.begin(), touched.end(), r) == touched.end())
+                        touched.push_back(r);
+                    break;
+                }
+                case PKT_DATA_ACK:
+                    on_data_ack(from, header, payload);
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            // 每批每个流只回复一次确认
+            for (size_t i = 0; i < touched.size(); i++)
+            {
+                if (touched[i]->need_ack)
+                {
+                    send_data_ack(touched[i]->peer, touched[i]->stream, touched[i]);
+                    touched[i]->need_ack = false;
+                }
+            }
+        }
+
+        // 在锁外按到达顺序交给回调，回调更新的状态对被唤醒的等待者可见
+        for (size_t i = 0; i < pending.size(); i++)
+            handler(pending[i].from, pending[i].msg, pending[i].len);
+        if (!pending.empty() || !touched.empty())
+            signal_event();
+    }
+
+    close(g_epollFd);
+    close(g_wakeFd);
+    g_epollFd = -1;
+    g_wakeFd = -1;
+}
+
+// ===== 发送端 =====
+
+bool transport_send_control(const struct sockaddr_in& peer, const void* msg, size_t len)
+{
+    std::lock_guard<std::mutex> send_lock(g_ctrlSendMutex);
+
+    PacketHeader header;
+    uint32_t seq;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        seq = ++g_ctrlSeq;
+    }
+    fill_header(header, PKT_CTRL, 0, seq, (uint32_t)len);
+
+    int rto = g_cfg.rto_ms;
+    for (int attempt = 0; attempt < TRANSPORT_CTRL_RETRIES; attempt++)
+    {
+        if (attempt > 0)
+            g_packetsRetransmitted++;
+        send_packet(peer, header, msg, len);
+
+        std::unique_lock<std::mutex> lock(g_mutex);
+        if (g_cond.wait_for(lock, std::chrono::milliseconds(rto), [seq] { return g_ctrlAcked == seq; }))
+            return true;
+        rto = std::min(rto * 2, MAX_RTO_MS);
+    }
+
+    printf("[Transport] control message to %s:%d not acknowledged\n",
+           inet_ntoa(peer.sin_addr), ntohs(peer.sin_port));
+    return false;
+}
+
+bool transport_send_bulk(const struct sockaddr_in& peer, uint32_t stream, const void* data, size_t bytes)
+{
+    TRACE_SCOPE("bulk_send", bytes);
+    const uint32_t chunk = payload_size();
+    const uint32_t npkts = (uint32_t)std::max<size_t>(1, (bytes + chunk - 1) / chunk);
+    const int B = TRANSPORT_BATCH;
+    const uint64_t base_rto_us = (uint64_t)g_cfg.rto_ms * 1000;
+    const int send_flags = g_cfg.zerocopy ? MSG_ZEROCOPY : 0;
+    const uint64_t begin_us = now_us();
+
+    BulkSend st;
+    st.peer = peer;
+    st.stream = stream;
+    st.npkts = npkts;
+    st.cum = 0;
+    st.highest = 0;
+    st.acked.assign(npkts, 0);
+    st.last_progress_us = now_us();
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_sends.push_back(&st);
+    }
+
+    std::vector<uint64_t> sent_at(npkts, 0);
+    std::vector<uint32_t> queue;
+    std::vector<struct mmsghdr> msgs(B);
+    std::vector<struct iovec> iovs(2 * B);
+    std::vector<PacketHeader> headers(npkts);   // 按包序号存放：零拷贝时内核引用报头直到完成通知
+    uint32_t next = 0;
+    uint64_t rto_us = base_rto_us;
+    uint32_t rto_cum = 0;   // 上次超时重传时的累计确认，用于指数退避
+    bool ok = true;
+
+    while (1)
+    {
+        queue.clear();
+        {
+            std::unique_lock<std::mutex> lock(g_mutex);
+            if (st.cum >= npkts)
+                break;
+
+            uint64_t now = now_us();
+            if (now - st.last_progress_us > (uint64_t)TRANSPORT_BULK_TIMEOUT_MS * 1000)
+            {
+                printf("[Transport] stream %u stalled at %u/%u packets, giving up\n", stream, st.cum, npkts);
+                ok = false;
+                break;
+            }
+            if (st.cum != rto_cum)
+            {
+                rto_us = base_rto_us;
+                rto_cum = st.cum;
+            }
+
+            // 选择重传：SACK 显示后面的包已到达而自身未确认的空洞
+            for (uint32_t seq = st.cum; seq < next && seq < st.highest; seq++)
+            {
+                if (!st.acked[seq] && now - sent_at[seq] > base_rto_us / 4)
+                    queue.push_back(seq);
+            }
+            // 超时重传：窗口长时间没有推进时只重发最早的未确认包探测，并指数退避
+            if (queue.empty() && st.cum < next && now - sent_at[st.cum] > rto_us)
+            {
+                queue.push_back(st.cum);
+                rto_us = std::min<uint64_t>(rto_us * 2, (uint64_t)MAX_RTO_MS * 1000);
+            }
+            size_t retrans = queue.size();
+
+            // 窗口内的新包
+            while (next < npkts && next < st.cum + g_cfg.window)
+                queue.push_back(next++);
+
+            if (queue.empty())
+            {
+                g_cond.wait_for(lock, std::chrono::microseconds(std::min<uint64_t>(rto_us, 1000)));
+                continue;
+            }
+            g_packetsRetransmitted += retrans;
+        }
+
+        // 批量发送：报头和数据分两段 iovec，数据直接引用调用者的缓冲区
+        for (size_t i = 0; i < queue.size(); i += B)
+        {
+            int cnt = (int)std::min<size_t>(B, queue.size() - i);
+            uint64_t now = now_us();
+            for (int j = 0; j < cnt; j++)
+            {
+                uint32_t seq = queue[i + j];
+                size_t offset = (size_t)seq * chunk;
+                size_t len = std::min<size_t>(chunk, bytes - std::min(bytes, offset));
+
+                // 重传时重写的内容与第一次完全相同，不影响仍在发送中的包
+                fill_header(headers[seq], PKT_DATA, stream, seq, (uint32_t)len);
+                headers[seq].chunk = (uint16_t)chunk;
+                headers[seq].total = bytes;
+
+                iovs[2 * j].iov_base = &headers[seq];
+                iovs[2 * j].iov_len = sizeof(PacketHeader);
+                iovs[2 * j + 1].iov_base = (char*)data + offset;
+                iovs[2 * j + 1].iov_len = len;
+
+                memset(&msgs[j], 0, sizeof(msgs[j]));
+                msgs[j].msg_hdr.msg_name = (void*)&peer;
+                msgs[j].msg_hdr.msg_namelen = sizeof(peer);
+                msgs[j].msg_hdr.msg_iov = &iovs[2 * j];
+                msgs[j].msg_hdr.msg_iovlen = (len > 0) ? 2 : 1;
+                sent_at[seq] = now;
+            }
+
+            int done = 0;
+            while (done < cnt)
+            {
+                int r = sendmmsg(g_sock, msgs.data() + done, cnt - done, send_flags);
+                if (r < 0)
+                {
+                    if (errno == EINTR || errno == EAGAIN || errno == ENOBUFS)
+                    {
+                        usleep(50);
+                        continue;
+                    }
+                    printf("[Transport] sendmmsg failed: %s\n", strerror(errno));
+                    break;
+                }
+                done += r;
+            }
+            g_packetsSent += done;
+            if (g_cfg.zerocopy)
+                g_zcIssued += done;
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        g_sends.erase(std::find(g_sends.begin(), g_sends.end(), &st));
+
+        // 零拷贝时内核可能仍引用着 data 中的页，等完成通知全部取回后才能把缓冲区还给调用者
+        if (g_cfg.zerocopy && !g_cond.wait_for(lock, std::chrono::milliseconds(TRANSPORT_BULK_TIMEOUT_MS),
+                                               [] { return g_zcCompleted >= g_zcIssued; }))
+        {
+            printf("[Transport] stream %u: zerocopy completions missing (%llu/%llu)\n", stream,
+                   (unsigned long long)g_zcCompleted.load(), (unsigned long long)g_zcIssued.load());
+        }
+    }
+    g_bulkBytes += bytes;
+    g_bulkUs += now_us() - begin_us;
+    return ok;
+}
+
+// ===== 接收流登记 =====
+
+void transport_post_receive(uint32_t stream, void* buffer, size_t capacity, size_t elem_size,
+                            std::atomic<size_t>* ready)
+{
+    BulkRecv* r = new BulkRecv;
+    r->stream = stream;
+    r->buffer = (char*)buffer;
+    r->capacity = capacity;
+    r->elem_size = elem_size;
+    r->ready = ready;
+    memset(&r->peer, 0, sizeof(r->peer));
+    r->total = 0;
+    r->chunk = 0;
+    r->npkts = 0;
+    r->cum = 0;
+    r->need_ack = false;
+    if (ready != NULL)
+        ready->store(0, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_closedStreams.erase(std::remove(g_closedStreams.begin(), g_closedStreams.end(), stream),
+                          g_closedStreams.end());
+    BulkRecv* old = find_recv(stream);
+    if (old != NULL)
+    {
+        g_recvs.erase(std::find(g_recvs.begin(), g_recvs.end(), old));
+        delete old;
+    }
+    g_recvs.push_back(r);
+}
+
+void transport_close_receive(uint32_t stream)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    BulkRecv* r = find_recv(stream);
+    if (r == NULL)
+        return;
+    g_recvs.erase(std::find(g_recvs.begin(), g_recvs.end(), r));
+    delete r;
+
+    // 只保留最近结束的若干个流
+    g_closedStreams.push_back(stream);
+    if (g_closedStreams.size() > 64)
+        g_closedStreams.erase(g_closedStreams.begin());
+}